@@ -7,59 +7,161 @@
     Author:         W.Zimmermann, Sept 08, 2020
     Modified by:    Enes Coskunyürek, 764552
                     Tolgahan Kandemir, 761469
+
+    The clock counts UTC seconds since 1 March 2000. Date, time and weekday are derived
+    from the seconds only when needed, e.g. for the display, see civilClock().
+    The zone rules are a constant table, see clockZones. The offset of the actual zone,
+    including daylight saving time, and the time of its next change are kept in the
+    clock state, so the local time is a single add, see readClock().
+    A leap second announced by DCF77 is inserted as second 60 at the end of the hour,
+    see leapClock().
+    The seconds start at the DCF77 second marks, see syncClock(). At each synchronization
+    the clock records how far it was off, see clockCorrectionSeconds and clockCorrection.
+
+    Compiler flags:
+    CLOCKSPRINTF    Format the display lines with sprintf instead of the lookup table,
+                    only for comparison, see the benchmark in hostMain.c
+    CLOCKDISCIPLINE Estimate the frequency error of the crystal from the DCF77 minute marks
+                    and trim the ticker, so the clock keeps the time also without signal,
+                    see disciplineClock()
 */
 
+#ifdef CLOCKSPRINTF
 #include <stdio.h>
+#endif
 
 #include "clock.h"
 #include "lcd.h"
 #include "led.h"
 #include "dcf77.h"
+#include "os.h"
+#include "ticker.h"
 
 // Defines
 #define ONESEC  (1000/10)                       // 10ms ticks per second
 #define MSEC200 (200/10)
+#define DAYSECONDS  86400UL                     // Seconds per day
+#define EPOCHYEAR   2000                        // Clock seconds count from 1 March of this year
+#define EPOCHDAY    3                           // Weekday of the epoch, Wednesday
+#define NEVER       0xFFFFFFFFUL                // Zone without daylight saving time
+#define TRIMMIN     3600UL                      // Shortest interval of a frequency measurement, seconds
+#define TRIMMAX     14400UL                     // Longest one, the time stamps wrap after 6.3 hours
+#define TRIMLIMIT   61440L                      // Largest correction, 0.94 counts per tick, 500ppm
 
 
-// Global variable holding the last clock event
-CLOCKEVENT clockEvent = NOCLOCKEVENT;
+// Queue of the clock events, each with the tickerTime() of the second tick
+osQueue clockQueue;
 DISPLAYEVENT displayEvent = NOUPDATE;
 
+// Seconds and timer counts the clock was ahead of the time set by the last setClockZone(),
+// the counts are within half a second, see correctClock()
+long clockCorrectionSeconds = 0;
+long clockCorrection = 0;
+#ifdef CLOCKDISCIPLINE
+// Correction of the ticker in 1/65536 timer counts per tick, see tickerTrim()
+long clockTrim = 0;
+#endif
+
+/* ********** MODULE TYPES **********
+ * CLOCKCHANGE:     Rule for a change from or to daylight saving time
+ *  month:          1..12
+ *  week:           Sunday of the month, 1..4 -> first..fourth, 5 -> last
+ *  hour:           Hour of the change in local standard time
+ *
+ * CLOCKZONE:       Rule of a time zone
+ *  name:           Display text, two characters
+ *  offset:         Standard time in minutes east of UTC
+ *  save:           Daylight saving time in minutes, 0 -> no daylight saving time
+ *  start, end:     Changes to and from daylight saving time
+ *
+ * CLOCKSTATE:      The state of the clock
+ *  seconds:        UTC seconds since 1 March 2000 00:00. Valid until 2136.
+ *  until:          seconds of the next change of offset, NEVER if there is none
+ *  offset:         Seconds of the local time ahead of UTC, including daylight saving time
+ *  zone:           Index of the actual zone in clockZones
+ *  dst:            1 -> daylight saving time
+ *  leap:           seconds of the first second after a leap second, NEVER if none
+ *  inserted:       1 -> the clock is in the leap second, i.e. second 60 after seconds
+ */
+typedef struct
+{   char month, week, hour;
+} CLOCKCHANGE;
+
+typedef struct
+{   char name[3];
+    int  offset, save;
+    CLOCKCHANGE start, end;
+} CLOCKZONE;
+
+typedef struct
+{   unsigned long seconds;
+    unsigned long until;
+    long offset;
+    unsigned char zone;
+    char dst;
+    unsigned long leap;
+    char inserted;
+} CLOCKSTATE;
+
 /* ********** MODULE GLOBAL VARIABLES **********
- * days, months:    days represent the actual year of the clock.
- *                  The maximum value depends on the maximum days of  month -> [1;28-31]
- *                  months represent the actual month of the year -> [1-12]
- *  
- * year:            years represent the actual year of the clock, starting with 2000        
- *  
- * hrs, mins, secs: Representation of the clock Time e.g 14:45:28
- *          
+ * clockBuffer[], clockNow:  The clock state, double buffered. The writers, setClock()
+ *                  and processEventsClock(), run in task context only. They change a copy
+ *                  in the other buffer, see editClock(), and publish it with a single
+ *                  pointer store, see publishClock(). Readers copy *clockNow, see
+ *                  readClock(), and never see a half updated time, also in ISR context.
+ *
  * ticks:           Counter variable for ticker
  */
-static char days  = 0, months = 0;
-static int  years = 0;
-static char hrs = 0, mins = 0, secs = 0;
-static int uptime = 0;
+static CLOCKSTATE clockBuffer[2];
+static CLOCKSTATE *volatile clockNow = &clockBuffer[0];
 static int ticks = 0;
-
-
-/* ********** GLOBAL VARIABLES **********
- * weekdays:        Pointer to reference days of the week.  
- * 
- * descZone:        Pointer to reference the Timezone of the clock.
- *                  Used for printing 
- *
- * zone:            Global Variable to differentiate in which zone the clock is set to.
- *
- * weekDecoder:     Used to map weekdays into String representing weekdays
- *
- * maxDayOfMonths:  Array to differenciate the maximum days of a month
+static unsigned long lastTick = 0;              // tickerNow() at the last call of tick10ms()
+static unsigned long secondStamp = 0;           // tickerTime() of the start of the actual second
+#ifdef CLOCKDISCIPLINE
+static unsigned long trimStamp;                 // Time stamp of the minute mark starting the measurement
+static unsigned long trimSeconds = NEVER;       // ... and its clock seconds, NEVER -> no measurement
+static unsigned int  trimUpdates = 0;           // Number of frequency measurements so far
+#endif
+
+static CLOCKSTATE *editClock(void);
+static void publishClock(CLOCKSTATE *state);
+static void correctClock(long seconds, long counts);
+static unsigned char readClock(CLOCKTIME *time);
+static void zoneClock(CLOCKSTATE *state);
+static unsigned long changeClock(const CLOCKCHANGE *change, int year);
+static void civilClock(unsigned long seconds, CLOCKTIME *time);
+static unsigned long secondsClock(int day, int month, int year, int hours, int minutes, int seconds);
+static unsigned long daysClock(int day, int month, int year);
+#ifndef CLOCKSPRINTF
+static void putTwoDigits(char *text, char value);
+#endif
+
+/* ********** MODULE CONSTANTS **********
+ * clockZones:      Zone rules, selected by timeZone(). The first one is the zone
+ *                  of the DCF77 signal, see CLOCKZONEDE. The rules of the northern
+ *                  hemisphere change to daylight saving time in spring, the rules of the
+ *                  southern one in autumn, i.e. start is later in the year than end.
+ * weekdays:        Display text of the weekdays, index is the weekday of CLOCKTIME
  */
-char *weekdays;
-char *descZone;
-int zone = 0;
-int weekDecoder = 0;
-int maxDayOfMonths[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+static const CLOCKZONE clockZones[CLOCKZONES] = {
+    { "DE",  60, 60, {  3, 5, 2 }, { 10, 5, 2 } }, // CET/CEST, 01:00 UTC, last Sunday of March/October
+    { "US", -300, 60, { 3, 2, 2 }, { 11, 1, 1 } }, // US Eastern, 2nd Sunday of March, 1st Sunday of November
+    { "UK",   0, 60, {  3, 5, 1 }, { 10, 5, 1 } }, // GMT/BST, 01:00 UTC, last Sunday of March/October
+    { "JP", 540,  0, {  0, 0, 0 }, {  0, 0, 0 } }  // JST, no daylight saving time
+};
+
+static const char *const weekdays[8] = { "---: ", "Mon: ", "Tue: ", "Wed: ", "Thu: ", "Fri. ", "Sat: ", "Sun: " };
+
+#ifndef CLOCKSPRINTF
+/* ********** MODULE CONSTANTS **********
+ * twoDigits:       Lookup table with the ASCII representation of 00..99,
+ *                  used by displayDateTimeClock instead of sprintf
+ */
+static const char twoDigits[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+#endif
 
 
 // ****************************************************************************
@@ -67,23 +169,37 @@ int maxDayOfMonths[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 //  Called once before using the module
 void initClock(void) {
     displayEvent = UPDATEDISPLAY;
+    osSetReady(OSTASKDISPLAY);
 }
 
 // ****************************************************************************
 // This function is called periodically every 10ms by the ticker interrupt.
 // Keep processing short in this function, run time must not exceed 10ms!
 // Callback function, never called by user directly.
+// In tickless mode (see ticker.c) several ticks may have elapsed since the last call.
 void tick10ms(void) {
-    if (++ticks >= ONESEC)                      // Check if one second has elapsed
-    {   clockEvent = SECONDTICK;                // ... if yes, set clock event
-        ticks=0;
-        setLED(0x01);                           // ... and turn on LED on port B.0 for 200msec
-    } else if (ticks == MSEC200)
+    unsigned long now = tickerNow();
+    int elapsed = (int) (now - lastTick);       // Always 1, if not in tickless mode
+    lastTick = now;
+
+    ticks = ticks + elapsed;
+    if (ticks >= ONESEC)                        // Check if one second has elapsed
+    {   (void) osPut(&clockQueue, SECONDTICK, tickerTime()); // ... if yes, queue clock event
+        osSetReady(OSTASKCLOCK);
+        ticks = ticks - ONESEC;
+        if (!tickerShed)                        // ... and turn on LED on port B.0 for 200msec,
+            setLED(0x01);                       //     not while the ticker is overloaded
+    } else if (ticks >= MSEC200 && ticks - elapsed < MSEC200)
     {   clrLED(0x01);
     }
-    uptime = uptime + 10;                       // Update CPU time base
 
-    dcf77Event = sampleSignalDCF77(uptime);     // Sample the DCF77 signal
+#ifndef DCF77CAPTURE                            // ... else edges are captured by isrECT1, see dcf77.c
+    (void) sampleSignalDCF77();                 // Sample the DCF77 signal, queues the events
+#endif
+
+#ifdef TICKLESS
+    tickerRequest(TICKERCLOCK, (ticks < MSEC200 ? MSEC200 : ONESEC) - ticks);
+#endif
 }
 
 // ****************************************************************************
@@ -93,53 +209,44 @@ void tick10ms(void) {
 // Returns:     -
 
 
-/* ********** Function: processEventsClock(CLOCKEVENT event) **********
+/* ********** Function: processEventsClock(osEvent event) **********
  * Description: Processing of the clock events.
  *              This function is called every seconds an will update the interal time values.
- * Parameters:  CLOCKEVENT event        prevent the clock from being incremented at NOCLOCKEVENT            
+ *              A zone switch requested in ISR context is done here, see requestTimeZone().
+ * Parameters:  osEvent event           CLOCKEVENT, prevent the clock from being incremented at NOCLOCKEVENT            
  * Return:      -
  */
-void processEventsClock(CLOCKEVENT event) {
+void processEventsClock(osEvent event) {
+    CLOCKSTATE *state;
+
     // CASE: NOCLOCKEVENT -> return
     if (event==NOCLOCKEVENT) {
         return;
     }
+
+    // CASE: ZONESWITCH -> SWITCH IN TASK CONTEXT
+    if (event==ZONESWITCH) {
+        timeZone();
+        return;
+    }
     
-    // INCREMENT SECONDS & HANDLE SECONDS OVERFLOW
-    secs++;
-    if(secs >= 60) {
-        secs = 0;
-
-        //INCREMENT MINUTES & HANDLE MINUTES OVERFLOW
-        mins++;
-        if(mins >= 60) {
-            mins = 0;
-
-            //INCREMENT HOURS & HANDLER HOURS OVERFLOW
-            hrs++;
-            if(hrs >= 24) {
-                hrs = 0;
-
-                //INCREMENT DAYS & HANDLE DAYS OVERFLOW
-                days++;
-                setLeapYear(years); 
-                if(daysOverflowed(months - 1, days) == 1) {
-                    days = 1;
-
-                    // INCREMENT MONTHS & HANDLE MONTHS OVERFLOW
-                    months++;
-                    if(months >= 13) {
-                        months = 1;
-
-                        // INCREMENT YEARS 
-                        years++;
-                    }
-                }
-            }
+    // INCREMENT SECONDS, THE CALENDAR IS ONLY DERIVED ON DEMAND, SEE readClock()
+    secondStamp = osEventTime;
+    state = editClock();
+    if(state->seconds + 1 == state->leap) {     // ... BUT INSERT A LEAP SECOND FIRST
+        state->leap = NEVER;
+        state->inserted = 1;
+    } else {
+        state->inserted = 0;
+        state->seconds++;
+        if(state->seconds >= state->until) {    // ... DAYLIGHT SAVING TIME STARTS OR ENDS
+            zoneClock(state);
         }
     }
+    publishClock(state);
 
     displayEvent = UPDATEDISPLAY;
+    osSetReady(OSTASKDISPLAY);
 }
 
 // ****************************************************************************
@@ -149,92 +256,263 @@ void processEventsClock(CLOCKEVENT event) {
 
 /* ********** FUNCTION: setClock(...) **********
  * Description: Function to reset the time of the clock and the date.
- *              Differnciate between US zone and DE zone
- * Parameters:  weekday, day, month, year, hours, minutes
+ *              The time is given in the actual zone, the weekday follows from the date.
+ *              Daylight saving time follows from the zone rules.
+ *              Task context only, see requestTimeZone() for ISR context.
+ * Parameters:  day, month, year, hours, minutes, seconds
  * Return:      -
  */
-void setClock(int weekday, int day, int month, int year, int hours, int minutes, int seconds) { 
-    // HANDLE LEAP YEAR
-    setLeapYear(years);
-
-    // FIT DATE AND TIME INTO US ZONE -> zone == 1
-    if(zone == 1){
-
-        // HANDLE UNDERFLOW OF HOURS
-        if(hours < 0){
-            hours = 24 + hours;  
-
-            // HANDLE UNDERFLOW OF WEEKDAY 
-            if(weekday == 1){
-                weekday = 7;
-            }else{
-                weekday--;
-            }
-
-            // HANDLE UNDERFLOW OF DATE 
-            day = day - 1;
-            if(day == 0){
-                month--;
-
-                // HANDLER UNDERLOW OF MONTH
-                if(month == 0){
-                    month = 12;
-                    year = year - 1;
-                }
-
-                // MAXIMUM DAY OF ACTUAL MONTH
-                day = maxDayOfMonths[month - 1];
-            }
-        }
-    
-    // FIT DATE AND TIME INTO DE ZONE -> zone == 0
-    } else if (zone == 0) {
-
-        // HANDLE OVERFLOW OF HOURS
-        if(hours >= 24) {
-            hours = hours - 24;
-
-            // HANDLE OVERFLOW OF WEEKDAY
-            if(weekday == 7) {
-                weekday = 0; 
-            } else {
-                weekday++;
-            }
-            
-            // HANDLE OVERFLOW OF DAYS
-            day = day + 1;   
-            if(daysOverflowed(month - 1, day) == 1) {
-                day = 1;
-
-                // HANDLE OVERFLOW OF MONTH
-                month = month + 1;
-                if(month >= 13) {
-                    month = 1;
-                    year++;
-                }
-            }
-        }
+void setClock(int day, int month, int year, int hours, int minutes, int seconds) {
+    CLOCKSTATE probe = *clockNow;
+    const CLOCKZONE *rule = &clockZones[probe.zone];
+
+    // UTC, IF THE TIME IS STANDARD TIME, TELLS WHETHER IT IS DAYLIGHT SAVING TIME
+    probe.seconds = secondsClock(day, month, year, hours, minutes, seconds) - (long) rule->offset * 60;
+    zoneClock(&probe);
+    setClockZone(day, month, year, hours, minutes, seconds, (int) (probe.offset / 60));
+}
+
+/* ********** FUNCTION: setClockZone(...) **********
+ * Description: Function to reset the time of the clock and the date with a known
+ *              offset to UTC, e.g. by the DCF77 module. The actual zone is kept.
+ *              Task context only.
+ * Parameters:  day, month, year, hours, minutes, seconds
+ *              int offset      minutes of the given time ahead of UTC, e.g. 120 for CEST
+ * Return:      -
+ */
+void setClockZone(int day, int month, int year, int hours, int minutes, int seconds, int offset) {
+    CLOCKSTATE *state;
+    unsigned long now, stamp = tickerTime();
+
+    // SET THE CLOCK SECONDS IN UTC, THE OFFSET OF THE ACTUAL ZONE AND PUBLISH THEM.
+    // A LEAP SECOND STAYS ANNOUNCED, UNLESS IT IS OVER
+    state = editClock();
+    state->seconds = secondsClock(day, month, year, hours, minutes, seconds) - (long) offset * 60;
+    correctClock((long) (clockNow->seconds - state->seconds), (long) (stamp - secondStamp));
+    secondStamp = stamp;
+    state->inserted = 0;
+    if(state->seconds >= state->leap) {
+        state->leap = NEVER;
     }
+    zoneClock(state);
+    publishClock(state);
 
-    // MAP WEEKDAY
-    weekDecoder = weekday;
-    if(weekday == 0) weekdays = "---: ";
-    if(weekday == 1) weekdays = "Mon: ";
-    if(weekday == 2) weekdays = "Tue: ";
-    if(weekday == 3) weekdays = "Wed: ";
-    if(weekday == 4) weekdays = "Thu: ";
-    if(weekday == 5) weekdays = "Fri. ";
-    if(weekday == 6) weekdays = "Sat: ";
-    if(weekday == 7) weekdays = "Sun: ";
-
-    // SET DATE AND TIME 
-    days     = (char) day;
-    months   = (char) month;
-    years    = (int)  year;
-    hrs      = (char) hours;
-    mins     = (char) minutes;
-    secs     = (char) seconds;
+    // RESTART COUNTING TICKS NOW, SEE tick10ms(), WHICH UPDATES BOTH IN ISR CONTEXT
+    now = tickerNow();
+    DisableInterrupts;
     ticks    = 0;
+    lastTick = now;
+    EnableInterrupts;
+}
+
+/* ********** FUNCTION: syncClock(...) **********
+ * Description: Start the actual second at a time in the past, e.g. the DCF77 minute
+ *              mark, instead of the call of setClockZone(). Compensates the latency
+ *              of the task, the ticks are aligned to the time stamp, see tickerAlign().
+ *              Call it right after setClockZone(), task context only.
+ * Parameter:   unsigned long stamp     tickerTimestamp() of the start of the second
+ * Return:      -
+ */
+void syncClock(unsigned long stamp) {
+    unsigned long first;
+
+    // THE CLOCK WAS SET LATE, I.E. IT WAS OFF BY LESS
+    correctClock(clockCorrectionSeconds, clockCorrection - (long) (secondStamp - stamp));
+    secondStamp = stamp;
+
+    // COUNT THE TICKS FROM THE TIME STAMP ON, SEE tick10ms()
+    DisableInterrupts;
+    first = tickerAlign(stamp);
+    ticks    = 0;
+    lastTick = first;
+    EnableInterrupts;
+}
+
+/* ********** FUNCTION: editClock() **********
+ * Description: Start a change of the clock state: copy the published state
+ *              into the other buffer. Task context only, see clockNow.
+ * Parameters:  -
+ * Return:      state to change, publish it with publishClock()
+ */
+static CLOCKSTATE *editClock(void) {
+    CLOCKSTATE *state = (clockNow == &clockBuffer[0]) ? &clockBuffer[1] : &clockBuffer[0];
+
+    *state = *clockNow;
+    return state;
+}
+
+/* ********** FUNCTION: publishClock(...) **********
+ * Description: Publish a changed clock state. A single pointer store, i.e. readers
+ *              in ISR context see either the old or the new state.
+ * Parameters:  CLOCKSTATE *state       state from editClock()
+ * Return:      -
+ */
+static void publishClock(CLOCKSTATE *state) {
+    clockNow = state;
+}
+
+/* ********** FUNCTION: correctClock(...) **********
+ * Description: Store how far the clock was ahead as whole seconds plus timer counts
+ *              within half a second. The counts alone would wrap a long after 3.2 hours,
+ *              e.g. at the first synchronization, when the clock still counts from the epoch.
+ * Parameters:  long seconds    seconds the clock was ahead
+ *              long counts     timer counts to add, any range
+ * Return:      -
+ */
+static void correctClock(long seconds, long counts) {
+    seconds = seconds + counts / (long) TICKERMS(1000);
+    counts = counts % (long) TICKERMS(1000);
+    if(counts > (long) TICKERMS(500)) {
+        counts = counts - (long) TICKERMS(1000);
+        seconds++;
+    } else if(counts <= -(long) TICKERMS(500)) {
+        counts = counts + (long) TICKERMS(1000);
+        seconds--;
+    }
+    clockCorrectionSeconds = seconds;
+    clockCorrection = counts;
+}
+
+/* ********** FUNCTION: readClock(...) **********
+ * Description: Date and time of the published clock state in the actual zone.
+ *              Can be called in task and ISR context.
+ * Parameters:  CLOCKTIME *time         destination
+ * Return:      index of the actual zone in clockZones
+ */
+static unsigned char readClock(CLOCKTIME *time) {
+    const CLOCKSTATE *state = clockNow;         // One consistent state
+
+    civilClock(state->seconds + state->offset, time);
+    time->dst = state->dst;
+    if(state->inserted) {
+        time->secs = 60;
+    }
+    return state->zone;
+}
+
+/* ********** FUNCTION: zoneClock(...) **********
+ * Description: Offset of the zone to UTC at the time of the clock state and the
+ *              time of its next change. Called only, when the clock is set, the
+ *              zone is switched or the offset changes, i.e. not every second.
+ * Parameters:  CLOCKSTATE *state       seconds and zone are set, the rest is computed
+ * Return:      -
+ */
+static void zoneClock(CLOCKSTATE *state) {
+    const CLOCKZONE *rule = &clockZones[state->zone];
+    unsigned long standard, start, end, next;
+    CLOCKTIME time;
+
+    // CASE: NO DAYLIGHT SAVING TIME
+    state->offset = (long) rule->offset * 60;
+    state->dst = 0;
+    state->until = NEVER;
+    if(rule->save == 0) {
+        return;
+    }
+
+    // CHANGES OF THE ACTUAL YEAR IN LOCAL STANDARD TIME
+    standard = state->seconds + state->offset;
+    civilClock(standard, &time);
+    start = changeClock(&rule->start, time.years);
+    end   = changeClock(&rule->end, time.years);
+    if(start < end) {
+        state->dst = (char) (standard >= start && standard < end);
+    } else {
+        state->dst = (char) (standard >= start || standard < end);
+    }
+
+    // NEXT CHANGE: THE FIRST ONE AFTER NOW IN THIS YEAR, ELSE THE FIRST ONE OF THE NEXT YEAR
+    if(standard < start && (standard >= end || start < end)) {
+        next = start;
+    } else if(standard < end) {
+        next = end;
+    } else {
+        start = changeClock(&rule->start, time.years + 1);
+        end   = changeClock(&rule->end, time.years + 1);
+        next  = start < end ? start : end;
+    }
+    if(state->dst) {
+        state->offset = state->offset + (long) rule->save * 60;
+    }
+    state->until = next - (long) rule->offset * 60;
+}
+
+/* ********** FUNCTION: changeClock(...) **********
+ * Description: Time of a change from or to daylight saving time in a year
+ * Parameters:  const CLOCKCHANGE *change
+ *              int year
+ * Return:      seconds since 1 March 2000 in local standard time
+ */
+static unsigned long changeClock(const CLOCKCHANGE *change, int year) {
+    unsigned long days;
+
+    // LAST SUNDAY: BACK FROM THE LAST DAY OF THE MONTH, (days + EPOCHDAY) % 7 ARE THE DAYS SINCE SUNDAY
+    if(change->week == 5) {
+        days = (change->month == 12 ? daysClock(1, 1, year + 1) : daysClock(1, change->month + 1, year)) - 1;
+        days = days - (days + EPOCHDAY) % 7;
+
+    // FIRST TO FOURTH SUNDAY: FORWARD FROM THE FIRST DAY OF THE MONTH
+    } else {
+        days = daysClock(1, change->month, year);
+        days = days + (7 - (days + EPOCHDAY) % 7) % 7 + 7 * (change->week - 1);
+    }
+    return days * DAYSECONDS + (long) change->hour * 3600;
+}
+
+/* ********** FUNCTION: civilClock(...) **********
+ * Description: Convert clock seconds into date, time and weekday in constant time.
+ *              The days are counted from 1 March, so the leap day is the last day
+ *              of a year and the month lengths repeat with a period of 153 days
+ *              for March to July and August to December (days-to-civil algorithm).
+ * Parameters:  unsigned long seconds   seconds since 1 March 2000
+ *              CLOCKTIME *time         destination
+ * Return:      -
+ */
+static void civilClock(unsigned long seconds, CLOCKTIME *time) {
+    unsigned long days = seconds / DAYSECONDS;
+    unsigned long rest = seconds % DAYSECONDS;
+    unsigned int years, dayOfYear, month;
+
+    // TIME OF DAY
+    time->hrs  = (char) (rest / 3600);
+    rest = rest % 3600;
+    time->mins = (char) (rest / 60);
+    time->secs = (char) (rest % 60);
+
+    // YEARS SINCE 1 MARCH 2000, CORRECTED FOR THE LEAP DAYS, AND DAY OF THAT YEAR
+    years = (unsigned int) ((days - days / 1460 + days / 36524 - days / 146096) / 365);
+    dayOfYear = (unsigned int) (days - (365UL * years + years / 4 - years / 100));
+
+    // MONTH STARTING WITH MARCH = 0, DAY OF MONTH
+    month = (5 * dayOfYear + 2) / 153;
+    time->days   = (char) (dayOfYear - (153 * month + 2) / 5 + 1);
+    time->months = (char) (month < 10 ? month + 3 : month - 9);
+    time->years  = (int) (EPOCHYEAR + years + (month >= 10));
+    time->weekday = (char) ((days + EPOCHDAY - 1) % 7 + 1);
+}
+
+/* ********** FUNCTION: secondsClock(...) **********
+ * Description: Convert date and time into clock seconds, inverse of civilClock().
+ *              Dates before 1 March 2000 are not supported.
+ * Parameters:  day, month, year, hours, minutes, seconds, the time may be out of range
+ * Return:      seconds since 1 March 2000
+ */
+static unsigned long secondsClock(int day, int month, int year, int hours, int minutes, int seconds) {
+    return daysClock(day, month, year) * DAYSECONDS + (long) hours * 3600 + (long) minutes * 60 + seconds;
+}
+
+/* ********** FUNCTION: daysClock(...) **********
+ * Description: Days of a date since 1 March 2000
+ * Parameters:  day, month, year
+ * Return:      days since 1 March 2000
+ */
+static unsigned long daysClock(int day, int month, int year) {
+    unsigned int years, dayOfYear;
+
+    // YEARS AND DAYS COUNTED FROM 1 MARCH, JANUARY AND FEBRUARY BELONG TO THE YEAR BEFORE
+    years = (unsigned int) (year - EPOCHYEAR - (month <= 2));
+    dayOfYear = (unsigned int) ((153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1);
+    return 365UL * years + years / 4 - years / 100 + dayOfYear;
 }
 
 // ****************************************************************************
@@ -245,79 +523,211 @@ void setClock(int weekday, int day, int month, int year, int hours, int minutes,
 /* ********** FUNCTION: displayDateTimeclock(...) **********
  * Description: Display the time derived from the clock module on the LCD display, line0;
  *              Display the date and weekday derived from the clock module on LCD display, line1;
- * Parameter:   DISPLAYEVENT event
+ * Parameter:   osEvent event           DISPLAYEVENT
  * Returns:     
  */
-void displayDateTimeClock(DISPLAYEVENT event) {
+void displayDateTimeClock(osEvent event) {
     char uhrzeit[32];
     char datum[32];
+    CLOCKTIME time;
+    const char *weekday;
+    const char *descZone;
     
     if (event==NOUPDATE) return;
 
-    // DEFINE ZONES FOR PRINTING
-    if(zone == 1){
-        descZone = "US";
-    }else{
-        descZone = "DE";
-    }
-    
-    (void) sprintf(uhrzeit, "%02d:%02d:%02d  %s", hrs, mins, secs, descZone, zone);
+    // ONE CONSISTENT COPY OF THE CLOCK RECORD, ZONE NAME FOR PRINTING
+    descZone = clockZones[readClock(&time)].name;
+    weekday = weekdays[(int) time.weekday];
+
+#ifdef CLOCKSPRINTF
+    (void) sprintf(uhrzeit, "%02d:%02d:%02d  %s", time.hrs, time.mins, time.secs, descZone);
+    writeLine(uhrzeit, 0);
+
+    (void) sprintf(datum, "%s%02d.%02d.%04d", weekday, time.days, time.months, time.years);
+    writeLine(datum, 1);
+#else
+    // LINE 0: "hh:mm:ss  ZZ"
+    putTwoDigits(&uhrzeit[0], time.hrs);
+    uhrzeit[2] = ':';
+    putTwoDigits(&uhrzeit[3], time.mins);
+    uhrzeit[5] = ':';
+    putTwoDigits(&uhrzeit[6], time.secs);
+    uhrzeit[8] = ' ';
+    uhrzeit[9] = ' ';
+    uhrzeit[10] = descZone[0];
+    uhrzeit[11] = descZone[1];
+    uhrzeit[12] = 0;
     writeLine(uhrzeit, 0);
 
-    (void) sprintf(datum, "%s%02d.%02d.%04d", weekdays, days, months, years);
+    // LINE 1: "Www: dd.mm.yyyy"
+    datum[0] = weekday[0];
+    datum[1] = weekday[1];
+    datum[2] = weekday[2];
+    datum[3] = weekday[3];
+    datum[4] = weekday[4];
+    putTwoDigits(&datum[5], time.days);
+    datum[7] = '.';
+    putTwoDigits(&datum[8], time.months);
+    datum[10] = '.';
+    putTwoDigits(&datum[11], (char) (time.years / 100));
+    putTwoDigits(&datum[13], (char) (time.years % 100));
+    datum[15] = 0;
     writeLine(datum, 1);
+#endif
 }
 
-/* ********** FUNCTION: timezone() **********
- * Description:     Function to switch the timeZone from US into DE and vice versa
- * Parameter:       -
+#ifndef CLOCKSPRINTF
+/* ********** FUNCTION: putTwoDigits(...) **********
+ * Description:     Write a value as two ASCII digits with leading zero, e.g. 7 -> "07"
+ * Parameter:       char *text      destination, two characters, no terminating 0
+ *                  char value      0..99
  * Return:          -
-*/
-void timeZone() {
-    // EU MODE -> US MODE
-    if(zone == 0){
-        zone = 1;
-        setClock(weekDecoder, days, months, years, (hrs-6), mins, secs);
-    
-    // US MODE -> EU MODE
-    }else if(zone == 1){
-        zone = 0;
-        setClock(weekDecoder, days, months, years, (hrs+6), mins, secs);
-    } 
+ */
+static void putTwoDigits(char *text, char value) {
+    const char *digits = &twoDigits[2 * (unsigned char) value];
+
+    text[0] = digits[0];
+    text[1] = digits[1];
 }
+#endif
 
-/* ********** FUNCTION: daysOverflowed(...) **********
- * Description:     Function to specify if the days have been overflowed
- * Parameter:       int month, int day
- * Return:          0 -> FALSE, 1-> TRUE
-*/
-int daysOverflowed(int month, int day) {
-    // CONFIGURE CASE OF LEAP YEAR
-    if(years % 400 == 0 || (years % 4 == 0 && years % 100 != 0)) {
-        maxDayOfMonths[1] = 29;
+/* ********** FUNCTION: getClock(...) **********
+ * Description: Function to read the time and date of the clock, e.g. to predict
+ *              the next DCF77 frame. Values as displayed, i.e. in the actual zone.
+ * Parameters:  pointers to weekday, day, month, year, hours, minutes, seconds
+ * Return:      -
+ */
+void getClock(int *weekday, int *day, int *month, int *year, int *hours, int *minutes, int *seconds) {
+    CLOCKTIME time;
+
+    readClock(&time);                           // One consistent state, no need to disable interrupts
+    *weekday = time.weekday;
+    *day = time.days;
+    *month = time.months;
+    *year = time.years;
+    *hours = time.hrs;
+    *minutes = time.mins;
+    *seconds = time.secs;
+}
+
+/* ********** FUNCTION: getClockZone(...) **********
+ * Description: Function to read the time and date of the clock in any zone, e.g. in
+ *              the DCF77 zone to predict the next frame. Can be called in task and ISR context.
+ * Parameters:  unsigned char zone      index in the zone table, e.g. CLOCKZONEDE
+ *              unsigned int ahead      seconds to add to the clock
+ *              CLOCKTIME *time         destination
+ * Return:      -
+ */
+void getClockZone(unsigned char zone, unsigned int ahead, CLOCKTIME *time) {
+    CLOCKSTATE state = *clockNow;
+
+    // THE OFFSET OF THE CLOCK STATE IS VALID, IF THE ZONE IS THE SAME AND DOES NOT CHANGE
+    state.seconds = state.seconds + ahead;
+    if(zone != state.zone || state.seconds >= state.until) {
+        state.zone = zone;
+        zoneClock(&state);
+    }
+    civilClock(state.seconds + state.offset, time);
+    time->dst = state.dst;
+    if(state.inserted && ahead == 0) {
+        time->secs = 60;
     }
+}
 
-    // CHECK FOR OVERFLOWED DAYS AND RETURN 1 IF OVERFLOWED
-    if( day > maxDayOfMonths[month]) {
-        return 1;
+/* ********** FUNCTION: leapClock() **********
+ * Description: Insert a leap second at the end of the actual hour, e.g. announced by
+ *              DCF77. The leap seconds are inserted at the end of an UTC hour, i.e. also
+ *              at the end of a local hour in all zones of the zone table.
+ *              Task context only.
+ * Parameter:   -
+ * Return:      -
+ */
+void leapClock(void) {
+    CLOCKSTATE *state = editClock();
+
+    if(!state->inserted) {
+        state->leap = (state->seconds / 3600 + 1) * 3600;
     }
+    publishClock(state);
 
-    // NO OVERFLOW
-    return 0;
+#ifdef CLOCKDISCIPLINE
+    trimSeconds = NEVER;                        // The hour is one second longer, measure again
+#endif
 }
 
-/* ********** FUNCTION: setLeapYear(...) **********
- * Description:     Function to set the leap year, if neccessary
- * Parameter:       int year
+#ifdef CLOCKDISCIPLINE
+/* ********** FUNCTION: disciplineClock(...) **********
+ * Description: Frequency locked loop. Compares the time stamps of two minute marks at
+ *              least one hour apart with the seconds between them. The difference is the
+ *              frequency error of the crystal, which is corrected by the ticker, see
+ *              tickerTrim(). The first measurement is taken as it is, the next ones
+ *              correct half of the remaining error, i.e. the noise of the time stamps
+ *              is averaged. Call it after setClockZone(), task context only.
+ * Parameter:   unsigned long stamp     tickerTimestamp() of the minute mark
+ * Return:      -
+ */
+void disciplineClock(unsigned long stamp) {
+    unsigned long seconds = clockNow->seconds;
+    unsigned long elapsed = seconds - trimSeconds;
+    long error, step;
+
+    // START A MEASUREMENT, IF THERE IS NONE OR IT TOOK TOO LONG
+    if(trimSeconds == NEVER || elapsed > TRIMMAX) {
+        trimStamp = stamp;
+        trimSeconds = seconds;
+        return;
+    }
+    if(elapsed < TRIMMIN) {
+        return;
+    }
+
+    // TIMER COUNTS TOO MANY, I.E. THE CRYSTAL IS TOO FAST. THE TIME STAMPS ARE ALREADY TRIMMED,
+    // SO THIS IS THE ERROR LEFT OVER BY clockTrim. MORE THAN 1000PPM WOULD OVERFLOW BELOW
+    error = (long) (stamp - trimStamp - elapsed * TICKERMS(1000));
+    trimStamp = stamp;
+    trimSeconds = seconds;
+    if(error > (long) (elapsed * TICKERMS(1000) / 1000) || error < -(long) (elapsed * TICKERMS(1000) / 1000)) {
+        return;
+    }
+
+    // COUNTS PER SECOND TO 1/65536 COUNTS PER TICK: * 65536 / 100 = * 512 / (25 / 32)
+    step = error * 512 / (long) (elapsed * 25 / 32);
+
+    // A CRYSTAL OUTSIDE OF THE TRIM RANGE, I.E. clockTrim PLUS THE LEFT OVER ERROR, IS A WRONG MINUTE MARK
+    if(clockTrim + step > TRIMLIMIT || clockTrim + step < -TRIMLIMIT) {
+        return;
+    }
+    if(trimUpdates > 0) {
+        step = step / 2;
+    }
+    trimUpdates++;
+    clockTrim = clockTrim + step;               // Stays within TRIMLIMIT, see above
+    tickerTrim(clockTrim);
+}
+#endif
+
+/* ********** FUNCTION: timezone() **********
+ * Description:     Function to switch to the next zone of the zone table.
+ *                  The clock seconds stay in UTC, only the offset changes.
+ *                  Task context only, see requestTimeZone() for ISR context.
+ * Parameter:       -
  * Return:          -
 */
-void setLeapYear(int year) {
-    // CASE: LEAP YEAR
-    if(year % 400 == 0 || (year % 4 == 0 && year % 100 != 0) ) {
-        maxDayOfMonths[1] = 29;
-    
-    // CASE: NO LEAP YEAR
-    } else {
-        maxDayOfMonths[1] = 28;
-    }
-}
\ No newline at end of file
+void timeZone() {
+    CLOCKSTATE *state = editClock();
+
+    state->zone = (unsigned char) ((state->zone + 1) % CLOCKZONES);
+    zoneClock(state);
+    publishClock(state);
+}
+
+/* ********** FUNCTION: requestTimeZone() **********
+ * Description:     Request a switch of the timeZone in ISR context, e.g. by the DCF77
+ *                  module. The clock task does the switch, see processEventsClock().
+ * Parameter:       -
+ * Return:          -
+*/
+void requestTimeZone(void) {
+    (void) osPut(&clockQueue, ZONESWITCH, tickerTime());
+    osSetReady(OSTASKCLOCK);
+}
@@ -7,21 +7,46 @@
     Author:   W.Zimmermann, Sept 08, 2020
 */
 
+#include "os.h"                                 // osQueue
+
 // Data type for clock events
-typedef enum { NOCLOCKEVENT=0, SECONDTICK } CLOCKEVENT;
+typedef enum { NOCLOCKEVENT=0, SECONDTICK, ZONESWITCH } CLOCKEVENT;
+
+// Data type for date and time as displayed, see getClockZone()
+typedef struct
+{   char days, months;                          // 1..31, 1..12
+    int  years;                                 // e.g. 2021
+    char hrs, mins, secs;                       // secs is 60 in a leap second
+    char weekday;                               // 1 = Monday .. 7 = Sunday
+    char dst;                                   // 1 -> daylight saving time
+} CLOCKTIME;
+
+// Time zones, see the zone table in clock.c
+#define CLOCKZONEDE 0                           // Zone of the DCF77 signal
+#define CLOCKZONES  4
 
 //Data type for display events
 typedef enum { NOUPDATE=0, UPDATEDISPLAY } DISPLAYEVENT;
 
-// Global variable holding the last clock event
-extern CLOCKEVENT clockEvent;
+// Queue of the clock events, filled by tick10ms(), and the display event
+extern osQueue clockQueue;
 extern DISPLAYEVENT displayEvent;
 
 // Public functions, for details see clock.c
 void initClock(void);
-void processEventsClock(CLOCKEVENT event);
-void setClock(int weekday, int day, int month, int year, int hours, int minutes, int seconds);
-void displayDateTimeClock(DISPLAYEVENT event);
+void processEventsClock(osEvent event);
+void setClock(int day, int month, int year, int hours, int minutes, int seconds);
+void setClockZone(int day, int month, int year, int hours, int minutes, int seconds, int offset);
+void getClockZone(unsigned char zone, unsigned int ahead, CLOCKTIME *time);
+void syncClock(unsigned long stamp);
+void leapClock(void);
+#ifdef CLOCKDISCIPLINE
+void disciplineClock(unsigned long stamp);
+extern long clockTrim;                          // Ticker correction, see tickerTrim()
+#endif
+extern long clockCorrectionSeconds;             // Seconds the clock was ahead at the last synchronization
+extern long clockCorrection;                    // ... plus these timer counts, less than half a second
+void getClock(int *weekday, int *day, int *month, int *year, int *hours, int *minutes, int *seconds);
+void displayDateTimeClock(osEvent event);
 void timeZone(void);
-int daysOverflowed(int month, int day);
-void setLeapYear();
+void requestTimeZone(void);
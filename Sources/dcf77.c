@@ -18,91 +18,164 @@
 */
 
 
-#include <hidef.h>                                      // Common defines
-#include <mc9s12dp256.h>                                // CPU specific defines
+#include "hal.h"                                        // Common and CPU specific defines
 #include <stdio.h>
 
 #include "dcf77.h"
 #include "led.h"
 #include "clock.h"
 #include "lcd.h"
+#include "ticker.h"
+#include "os.h"
+
+// Defines
+#define IDLETICKS   10                                  // Sampling period in ticks while the signal is lost (tickless mode)
+#define TIMER_CH1   0x02                                // Bit position for ECT channel 1 (input capture mode)
+#define TCTL4_CH1   0x0C                                // Mask corresponds to TCTL4 EDG1B, EDG1A: capture both edges
+#define TIMER_CH6   0x40                                // Bit position for ECT channel 6 (oversampling)
+#define TCTL1_CH6   0x30                                // Mask corresponds to TCTL1 OM6, OL6
+#define ONEMS       187                                 // 1ms are 187.5 timer counts, alternating 187 and 188
+#define SAMPLEEDGES 4                                   // Edges per 10ms batch (oversampling)
+#define LOSTEVENTS  0x80                                // Queue data flag: events were lost before this one
+
+#ifdef DCF77CAPTURE                                     // Captured edges need no oversampling
+#undef DCF77OVERSAMPLE
+#endif
 
 /* ********** GLOBAL VARIABLES **********
- * dcf77Event:      Global variable to holf the last DCF77 event
- * tLowCounter:     Counter to validate a low period.
- * minutecounter:   Counter to validate the minute period
- * secondCounter:   Counter to validate a second perriod
- * position:        Referrer to index the bit-sequence
- * invalid:         Variable to show a invalid bit-sequence
- * bits[]:          Array to store the BCD bit-sequence     
+ * dcf77Queue:      Queue of the DCF77 events for processEventsDCF77(), see os.c.
+ *                  Filled by tick10ms() or isrECT1, i.e. always in ISR context
+ * dcf77Decoder:    Decoder state, the pulse classification and frame assembly
+ *                  are done by the decoder, see dcf77Decoder.c
 */
-DCF77EVENT dcf77Event = NODCF77EVENT;
-int tLowCounter = 0;
-int minuteCounter = 0;
-int secondCounter = 0;
-int position = 0;
-int invalid = 0;
-int bits[59];
+osQueue dcf77Queue;
+DCF77DECODER dcf77Decoder;
 
 
-
-/* ********** EXTERN GLOBAL VARIABLES **********
- * zone:            Extern global variable to determine DE or US timezone 
- * maxDayOfMonths:  Extern global variable to store maximum days of a month
-*/
-extern zone;
-extern int maxDayOfMonths[];
-
 /* ********** MODULE VARIABLES **********
- * minutes:         variable to store minutes of bit-sequence   
- * hours:           variable to store hours of bit-sequence
- * day:             variable to store day of bit-sequence
- * month:           variable to store month of bit-sequence
- * year:            variable to store year of bit-sequence
- * weekDecoder:     variable to store weekDecoder of bit-sequence
- * lastSignal:      variable to store the lastSignal, to determine rising or falling edges
+ * sampleTime:      time stamp of the last sample, see tickerTime(). The decoder times are
+ *                  time stamps in all modes, i.e. in timer counts.
 */
-static int minutes;
-static int hours;
-static int day;
-static int month;
-static int year;
-static int weekDecoder;
-static char lastSignal = 1;
-
-static int  dcf77Year=2020, dcf77Month=3, dcf77Day=1, dcf77Hour=2, dcf77Minute=0, dcf77Second=0, dcf77Weekday=0; //dcf77 Date and time as integer values
+#ifndef DCF77CAPTURE
+static unsigned long sampleTime = 0;
+#endif
+
+/* ********** OVERSAMPLING VARIABLES (compiler flag DCF77OVERSAMPLE) **********
+ * dcf77Filter:     glitch filter of the 1ms samples
+ * filterLevel:     filtered signal level of the last sample
+ * filterPhase:     alternates the 1ms period between 187 and 188 timer counts
+ * edgeSignal[], edgeCount:  filtered edges since the last 10ms tick
+ * edgeStamp[]:     TCNT value of the samples with an edge, see tickerTimestamp()
+ * dcf77EdgeOverflows:  edges lost, because more than SAMPLEEDGES came within 10ms
+*/
+#ifdef DCF77OVERSAMPLE
+static DCF77FILTER dcf77Filter;
+static char filterLevel = 1;
+static unsigned char filterPhase = 0;
+static char edgeSignal[SAMPLEEDGES];
+static unsigned short edgeStamp[SAMPLEEDGES];
+static unsigned char edgeCount = 0;
+unsigned long dcf77EdgeOverflows = 0;
+#endif
+
+static char synced = 0;                                 // clock was set by DCF77 at least once
+static char markEvent = 0;                              // 1 -> the decoder processes a minute mark, see osEventTime
+static char lostEvent = 0;                              // 1 -> events were lost, the next one gets LOSTEVENTS, ISR context
+
+static void frameReadyDCF77(DCF77DECODER *decoder, const DCF77TIME *time);
+static void putEventDCF77(DCF77EVENT event, unsigned long time);
+static void predictDCF77(void);
+#ifdef DCF77OVERSAMPLE
+static void shedOversampling(void);
+#endif
+
+static int  dcf77Year=2020, dcf77Month=3, dcf77Day=1, dcf77Hour=2, dcf77Minute=0, dcf77Second=0; //dcf77 Date and time as integer values
 
 
 // ****************************************************************************
 //  Initialize DCF77 module
 //  Called once before using the module
 void initDCF77(void) {   
-    setClock(dcf77Weekday, dcf77Day, dcf77Month, dcf77Year, dcf77Hour, dcf77Minute, dcf77Second);
+    setClock(dcf77Day, dcf77Month, dcf77Year, dcf77Hour, dcf77Minute, dcf77Second);
 
-    #ifdef SIMULATOR
+    initDecoderDCF77(&dcf77Decoder, TICKERMS(1000), frameReadyDCF77);  // Time stamps, see tickerTime()
+    #if defined(DCF77CAPTURE)
+        initializeCapture();
+    #elif defined(SIMULATOR)
         initializePortSim();
     #else
         initializePort();
     #endif    
+
+    #ifdef DCF77OVERSAMPLE
+        initializeOversampling();
+    #endif
 }
 
 // ****************************************************************************
 //  Read and evaluate DCF77 signal and detect events
 //  Must be called by user every 10ms
-//  Parameter:  Current CPU time base in milliseconds
+//  Parameter:  -
 //  Returns:    DCF77 event, i.e. second pulse, 0 or 1 data bit or minute marker
 
 
+#ifndef DCF77CAPTURE
 /* ********** Function sampleSiglanDCF77(...) ********** 
  * Description:     Read and evaluate DCF77 signal and detect events.
- *                  Must be called by user every 10ms
- * Parameter:       Current CPU time base in milliseconds
- *                  NOTE: currentTime is not used
- * Return:          DCF77EVENT - represents the actual event
+ *                  Must be called by user every 10ms, in tickless mode
+ *                  it requests the next call from the ticker itself.
+ *                  With DCF77OVERSAMPLE, the edges found by isrECT6 in the
+ *                  last 10ms are classified instead of sampling the port.
+ *                  The pulses are measured with time stamps, see tickerTime().
+ * Parameter:       -
+ * Return:          DCF77EVENT - represents the actual event,
+ *                  the events are also queued in dcf77Queue
  */
-DCF77EVENT sampleSignalDCF77(int currentTime) {
-    DCF77EVENT event = NODCF77EVENT;
+DCF77EVENT sampleSignalDCF77(void) {
+    DCF77EVENT event;
+#ifdef DCF77OVERSAMPLE
+    DCF77EVENT edgeEvent;
+    unsigned long stamp;
+    unsigned char i;
+#else
     char currentSignal;
+#endif
+
+#ifdef DCF77OVERSAMPLE
+    shedOversampling();
+
+    // CLASSIFY THE EDGES OF THE LAST 10MS, isrECT6 CANNOT INTERRUPT tick10ms().
+    // EVERY EVENT IS QUEUED, THE LAST ONE IS RETURNED.
+    event = NODCF77EVENT;
+    for(i = 0; i < edgeCount; i++) {
+        if(!tickerShed) {                               // NO LED WHILE THE TICKER IS OVERLOADED
+            if(edgeSignal[i]) {
+                clrLED(0x02);
+            } else {
+                setLED(0x02);
+            }
+        }
+        stamp = tickerTimestamp(edgeStamp[i]);
+        edgeEvent = edgeDecoderDCF77(&dcf77Decoder, edgeSignal[i], stamp);
+        if(edgeEvent == VALIDSECOND && (PTH & 0x04)) {
+            //Button3 pressed
+            requestTimeZone();
+        }
+        if(edgeEvent != NODCF77EVENT) {
+            putEventDCF77(edgeEvent, stamp);
+            event = edgeEvent;
+        }
+    }
+    edgeCount = 0;
+    sampleTime = tickerTime();
+
+    // NO EDGE: CHECK FOR SIGNAL LOSS
+    if(event == NODCF77EVENT) {
+        event = sampleDecoderDCF77(&dcf77Decoder, dcf77Decoder.lastSignal, sampleTime);
+        putEventDCF77(event, sampleTime);
+    }
+#else
+    sampleTime = tickerTime();
 
     #ifdef SIMULATOR
         currentSignal = readPortSim();			// Sample simulated DCF77 signal
@@ -110,243 +183,293 @@ DCF77EVENT sampleSignalDCF77(int currentTime) {
         currentSignal = readPort();				// Sample DCF77 signal
     #endif   
 
-    // CHECK IF CURRENTSIGNAL HAS CHANGED WITH LAST SIGNAL - EDGE DETECTED
-    if(currentSignal != lastSignal) {
-        
-        // ~RISING EDGE
+    // EDGES: LED ON PORT B.1 IS ON WHILE THE SIGNAL IS LOW, NOT WHILE THE TICKER IS OVERLOADED
+    if(currentSignal != dcf77Decoder.lastSignal && !tickerShed) {
         if(currentSignal > 0) {
-            
-            // ASSUME THAT EVENT IS INVALID AND CHECK OPPOSITE 
-            event = INVALID;
-
-            // CLEAR LED ON PORT B.1 
             clrLED(0x02);
+        } else {
+            setLED(0x02);
+        }
+    }
 
-            // CHECK FOR VALID ONE
-            if(tLowCounter >= 170 && tLowCounter <= 230) {
-                event = VALIDONE;
-            }
-            
-            //CHECK FOR VALID ZERO
-            if(tLowCounter >= 70 && tLowCounter <= 130) {
-                event = VALIDZERO;
-            }
+    event = sampleDecoderDCF77(&dcf77Decoder, currentSignal, sampleTime);
 
-            // RESET LOWCOUNTER
-            tLowCounter = 0;
+    if(event == VALIDSECOND && (PTH & 0x04)) {
+        //Button3 pressed
+        requestTimeZone();
+    }
+    putEventDCF77(event, sampleTime);
+#endif
 
-        // ~FALLING EDGE
-        } else {
-            // RESET LOWCOUNTER
-            tLowCounter = 0;
+    #ifdef TICKLESS
+        // SAMPLE SLOWER WHILE THE SIGNAL IS LOST
+        tickerRequest(TICKERDCF77, sampleTime - dcf77Decoder.lastFalling >= dcf77Decoder.minuteMax ? IDLETICKS : 1);
+    #endif
 
-            // ASSUME THAT EVENT IS INVALID AND CHECK OPPOSITE 
-            event = INVALID;
+    return event;
+}
+#endif
 
-            // TURN LED ON PORT B.1 ON
-            setLED(0x02);
 
-            // CHECK FOR VALID MINUTE
-            if(minuteCounter >= 1900 && minuteCounter <= 2100) {
-                event = VALIDMINUTE;
-            }
+#ifdef DCF77OVERSAMPLE
+/* ********** FUNCTION: initializeOversampling() **********
+ * Description:     Oversampling mode (compiler flag DCF77OVERSAMPLE):
+ *                  ECT channel 6 samples the DCF77 signal every 1ms, see isrECT6().
+ *                  The interrupt runs continuously, also in tickless mode.
+ * Parameter:       -
+ * Return:          -
+ */
+void initializeOversampling(void) {
+    initFilterDecoderDCF77(&dcf77Filter);
+    TIOS  = TIOS | TIMER_CH6;                           // Channel 6 in output compare mode
+    TC6   = TCNT + ONEMS;                               // First sample
+    TCTL1 = TCTL1 & ~TCTL1_CH6;                         // No output pin action
+    TFLG1 = TIMER_CH6;                                  // Clear a pending flag
+    TIE   = TIE | TIMER_CH6;                            // Enable channel 6 interrupt
+}
 
-            // CHECK FOR SECOND
-            if(secondCounter >= 900 && secondCounter <= 1100) {
-                event = VALIDSECOND;
-                if (PTH & 0x04){
-                    //Button3 pressed
-                    timeZone();
-                }
-                secondCounter = 0;
-            }
-            
-            // RESET COUNTER
-            minuteCounter = 0;
-            secondCounter = 0;
+/* ********** FUNCTION: shedOversampling() **********
+ * Description:     Load shedding while the ticker is overloaded, see tickerShed in
+ *                  ticker.c: isrECT6 is stopped and the port is sampled every 10ms
+ *                  without glitch filter instead, the edges are stored for
+ *                  sampleSignalDCF77() as usual. Afterwards the 1ms sampling resumes
+ *                  with the filter at the current level.
+ *                  Called by sampleSignalDCF77(), i.e. in ISR context.
+ * Parameter:       -
+ * Return:          -
+ */
+static void shedOversampling(void) {
+    char signal;
+
+    if(tickerShed) {
+        TIE = TIE & ~TIMER_CH6;                         // Stop the 1ms samples
+        #ifdef SIMULATOR
+            signal = readPortSim();
+        #else
+            signal = readPort();
+        #endif
+        if(signal != filterLevel && edgeCount < SAMPLEEDGES) {
+            filterLevel = signal;
+            edgeSignal[edgeCount] = signal;
+            edgeStamp[edgeCount] = TCNT;
+            edgeCount++;
+        }
+    } else if(!(TIE & TIMER_CH6)) {
+        dcf77Filter.history = filterLevel ? 0xFF : 0x00;
+        dcf77Filter.level = filterLevel;
+        TC6   = TCNT + ONEMS;                           // Resume the 1ms samples
+        TFLG1 = TIMER_CH6;
+        TIE   = TIE | TIMER_CH6;
+    }
+}
+
+/* ********** FUNCTION: isrECT6() **********
+ * Description:     Interrupt service routine, called every 1ms. Deglitches the
+ *                  signal and stores the filtered edges for the next 10ms tick.
+ *                  Constant run time without loops, one edge at most.
+ * Parameter:       -
+ * Return:          -
+ */
+void HAL_ISR(14) isrECT6(void) {
+    unsigned short stamp;
+    char signal;
+
+    osProfileStart(OSPROFILESAMPLE);
+    stamp = TC6;                                        // Time of this sample
+    filterPhase ^= 1;
+    TC6 = stamp + ONEMS + filterPhase;                  // Schedule the next sample
+    TFLG1 = TIMER_CH6;                                  // Clear the interrupt flag
+
+    #ifdef SIMULATOR
+        signal = filterDecoderDCF77(&dcf77Filter, readPortSim1ms());
+    #else
+        signal = filterDecoderDCF77(&dcf77Filter, readPort());
+    #endif
+
+    if(signal != filterLevel) {
+        filterLevel = signal;
+        if(edgeCount < SAMPLEEDGES) {
+            edgeSignal[edgeCount] = signal;
+            edgeStamp[edgeCount] = stamp;
+            edgeCount++;
+        } else {
+            dcf77EdgeOverflows++;
         }
-    } else {
-        // ~NO EDGE
-        event = NODCF77EVENT;
+    }
+    osProfileEnd(OSPROFILESAMPLE);
+}
+#endif
+
+
+#ifdef DCF77CAPTURE
+/* ********** FUNCTION: initializeCapture() **********
+ * Description:     Input capture mode (compiler flag DCF77CAPTURE):
+ *                  The DCF77 receiver is connected to port T.1, ECT channel 1
+ *                  captures the TCNT value of every edge, see isrECT1().
+ *                  There is no sampling in tick10ms() in this mode.
+ * Parameter:       -
+ * Return:          -
+ */
+void initializeCapture(void) {
+    DDRT  = DDRT & ~TIMER_CH1;                          // Port T.1 as input
+    TIOS  = TIOS & ~TIMER_CH1;                          // Channel 1 in input capture mode
+    TCTL4 = TCTL4 | TCTL4_CH1;                          // Capture rising and falling edges
+    TFLG1 = TIMER_CH1;                                  // Clear a pending flag
+    TIE   = TIE | TIMER_CH1;                            // Enable channel 1 interrupt
+}
 
-        // CHECK FOR INVALID MINUTE COUNTER
-        if(minuteCounter >= 2100) {
-            event = INVALID;
+/* ********** FUNCTION: isrECT1() **********
+ * Description:     Interrupt service routine, called at every edge of the DCF77 signal.
+ *                  The decoder classifies the pulse with the captured time stamps
+ *                  at TCNT resolution (5.33us).
+ * Parameter:       -
+ * Return:          -
+ */
+void HAL_ISR(9) isrECT1(void) {
+    unsigned long now;
+    char signal;
+    DCF77EVENT event;
+
+    osProfileStart(OSPROFILECAPTURE);
+    now = tickerTimestamp(TC1);
+    signal = (char) ((PTT & TIMER_CH1) != 0);
+    TFLG1 = TIMER_CH1;                                  // Clear the interrupt flag
+
+    // LED ON PORT B.1 IS ON WHILE THE SIGNAL IS LOW, NOT WHILE THE TICKER IS OVERLOADED
+    if(!tickerShed) {
+        if(signal) {
+            clrLED(0x02);
+        } else {
+            setLED(0x02);
         }
     }
 
-    // INCREMENT COUNTERS
-    minuteCounter += 10;
-    tLowCounter += 10;
-    secondCounter += 10;
+    event = edgeDecoderDCF77(&dcf77Decoder, signal, now);
 
-    // UPDATE LAST SIGNAL
-    lastSignal = currentSignal;
+    if(event == VALIDSECOND && (PTH & 0x04)) {
+        //Button3 pressed
+        requestTimeZone();
+    }
 
-    return event;
+    putEventDCF77(event, now);
+    osProfileEnd(OSPROFILECAPTURE);
+}
+#endif
+
+
+/* ********** FUNCTION: putEventDCF77(...) **********
+ * Description:     Queue a DCF77 event for processEventsDCF77(), if any.
+ *                  Only called in ISR context, i.e. by the single producer of dcf77Queue.
+ *                  The data byte of the event is its tag + 1, see tagDecoderDCF77(). After
+ *                  events were lost in a full queue, the next event gets LOSTEVENTS, so
+ *                  processEventsDCF77() discards the frame instead of counting the bits
+ *                  after the gap at the wrong positions.
+ * Parameter:       DCF77EVENT event
+ *                  unsigned long time      time stamp, see tickerTimestamp()
+ * Return:          -
+ */
+static void putEventDCF77(DCF77EVENT event, unsigned long time) {
+    unsigned char data;
+
+    if(event == NODCF77EVENT) {
+        return;
+    }
+    data = (unsigned char) (tagDecoderDCF77(&dcf77Decoder, event) + 1);     // -1..59 -> 0..60
+    if(lostEvent) {
+        data |= LOSTEVENTS;
+    }
+    lostEvent = (char) !osPutData(&dcf77Queue, (unsigned char) event, data, time);
+    osSetReady(OSTASKDCF77);
 }
 
 
 /* ********** FUNCTION: processEventxDCF77 **********
  * Description:     Function that reads the triggered events.
- * Parameters:      DCF77EVENT event
+ *                  The decoder assembles the frame and calls frameReadyDCF77().
+ *                  Once synchronized, the frame is predicted from the clock and
+ *                  compared bit by bit, see predictDCF77().
+ * Parameters:      osEvent event           DCF77EVENT
  * return:          -
  */
-void processEventsDCF77(DCF77EVENT event) {   
-    
-    switch(event){
-
-        // CASE INVALID: 
-        case INVALID: 
-            // set invalid to show, that the signal was invalid
-            invalid = 1; 
-
-            // reset reading position 
-            position = 0;
-
-            // clear LED on PORT B.2
-            clrLED(0x04);
-            break;
-
-        // CASE VALIDZERO:
-        case VALIDZERO: 
-            // read a valid zero into the bits array
-            if(invalid == 0) bits[position] = 0; 
-            break;
-
-        // CASE VALIDSECONDS
-        case VALIDSECOND: 
-            // increment position referrer every valid second 
-            if(invalid == 0) position++; 
-            break;
-
-        // CASE VALIDMINUTE:
-        case VALIDMINUTE: 
-            // check if position referrer is at the end -> decodeDateTime
-            if(position == 58) decodeDateTime();    
-
-            // reset position referrer and invalid
-            position = 0;
-            invalid = 0; 
-            break;    
-
-        // CASE VALIDONE:
-        case VALIDONE: 
-            // read a valid 1 into the bits array
-            if(invalid == 0) bits[position] = 1; 
-            break;
-
-        // CASE NODCF77EVENT:
-        case NODCF77EVENT: 
-            break;
-    }
-}
+void processEventsDCF77(osEvent event) {   
+    int result;
 
+    // THE FALLING EDGE OF THE MINUTE MARK STARTS SECOND 0 OF THE DECODED FRAME
+    markEvent = (char) (event == VALIDMINUTE);
 
-/* ********** FUNCTION: devodeDateTime() **********
- * Description:     Function to decode the DCF77 bit-sequence.
- *                  Check parity bits for a valid sequence and 
- *                  synchronize the day and time. 
- * Parameter:       -
- * Return:          - 
- */
-void decodeDateTime() {
-    minutes = 0;
-    hours = 0;
-    day = 0;
-    month = 0;
-    year = 0;
-    weekDecoder = 0;
-
-    // READ MINUTES: 7 BITS
-    minutes += bits[21];
-    minutes += bits[22] * 2;
-    minutes += bits[23] * 4;
-    minutes += bits[24] * 8;
-    minutes += (bits[25] * 10);
-    minutes += (bits[26] * 20);
-    minutes += (bits[27] * 40);
-    
-    // READ HOURS: 7 BITS
-    hours += bits[29];
-    hours += bits[30] * 2;
-    hours += bits[31] * 4;
-    hours += bits[32] * 8;
-    hours += (bits[33] * 10);
-    hours += (bits[34] * 20);
-
-    // READ DAYS: 6 BITS
-    day += bits[36];
-    day += bits[37] * 2;
-    day += bits[38] * 4;
-    day += bits[39] * 8;
-    day += (bits[40] * 10);
-    day += (bits[41] * 20);
-
-    // READ MONTHS: 5 BITS
-    month += bits[45];
-    month += bits[46] * 2;
-    month += bits[47] * 4;
-    month += bits[48] * 8;
-    month += (bits[49] * 10);
-
-    // READ YEARS: 8 BITS
-    year += bits[50];
-    year += bits[51] * 2;
-    year += bits[52] * 4;
-    year += bits[53] * 8;
-    year += (bits[54] * 10);
-    year += (bits[55] * 20);
-    year += (bits[56] * 40);
-    year += (bits[57] * 80);
-    year += 2000;
-    
-    // READ WEEKDAY: 3 BITS
-    weekDecoder += bits[42];
-    weekDecoder += bits[43] * 2;
-    weekDecoder += bits[44] * 4;
-
-    // CHECK PARITY
-    // CASE: INVALID PARITY
-    if(checkParity(21, 27) || checkParity(29, 34) || checkParity(36, 57)) {
-        invalid = 1;
+    // EVENTS WERE LOST BEFORE THIS ONE: DISCARD THE FRAME, THE BITS AFTER THE GAP WOULD BE MISALIGNED
+    if(osEventData & LOSTEVENTS) {
+        (void) taggedEventDecoderDCF77(&dcf77Decoder, INVALID, DCF77TAGLOST);
+    }
+    result = taggedEventDecoderDCF77(&dcf77Decoder, (DCF77EVENT) event, (signed char) ((osEventData & ~LOSTEVENTS) - 1));
+
+    // CLEAR LED ON PORT B.2 FOR AN INVALID SIGNAL, LOST EVENTS, AN INVALID PARITY OR A BIT NOT MATCHING THE CLOCK
+    if(result < 0 || event == INVALID || (osEventData & LOSTEVENTS)) {
         clrLED(0x04);
-    
-    // CASE: VALID PARITY
-    } else {
-        setLeapYear(year);
+    }
+
+    // SET LED ON PORT B.2 AS SOON AS THE PREDICTION IS CONFIRMED
+    if(result == 2) {
         setLED(0x04);
     }
 
-    // SET CLOCK
-    if(invalid != 1) {
-        // CASE: USA TIMEZONE
-        if(zone == 1) { 
-            setClock(weekDecoder, day, month, year, hours - 6, minutes, 0);
-        
-        // CASE: DE TIMEZONE
-        } else {        
-            setClock(weekDecoder, day, month, year, hours, minutes, 0);
-        }
+    if(event == VALIDMINUTE && synced) {
+        predictDCF77();
     }
 }
 
-/* ********** FUNCTION: checkParity(...) ********** 
- * Description: Function to check for event parity.
- * Parameters:  int startIndex, int endindex
- * Returns:     0 -> VALID PARITY
- *              1 -> INVALID PARITY
+/* ********** FUNCTION: predictDCF77() **********
+ * Description:     Predict the frame, which starts with this minute marker, from the clock.
+ *                  The frame contains the German time of the next minute.
+ * Parameters:      -
+ * return:          -
  */
-int checkParity(int startIndex, int endIndex) {
-    // COUNTER TO COUNT ONES IN BIT-SEQUENCE
-    int counter = 0;
+static void predictDCF77(void) {
+    CLOCKTIME local;
+    DCF77TIME time;
+
+    // GERMAN TIME 90s AHEAD, i.e. ROUND TO THE MINUTE MARKER AND ADD ONE MINUTE
+    getClockZone(CLOCKZONEDE, 90, &local);
+    time.weekday = local.weekday;
+    time.day = local.days;
+    time.month = local.months;
+    time.year = local.years;
+    time.hour = local.hrs;
+    time.minute = local.mins;
+    time.summer = local.dst;
+    time.announce = 0;                                  // Bits 0..19 are not predicted
+    time.leap = 0;
+    predictDecoderDCF77(&dcf77Decoder, &time);
+}
+
 
-    // LOOP FROM STARTINDEX TO ENDINDEX 
-    for(startIndex; startIndex <= (endIndex + 1); startIndex++){
-        if(bits[startIndex] == 1) counter++; //increment counter 
+/* ********** FUNCTION: frameReadyDCF77(...) **********
+ * Description:     Called by the decoder for a complete frame with valid parity.
+ *                  Synchronize the day and time.
+ * Parameter:       DCF77DECODER *decoder
+ *                  const DCF77TIME *time   decoded date and time
+ * Return:          - 
+ */
+static void frameReadyDCF77(DCF77DECODER *decoder, const DCF77TIME *time) {
+    (void) decoder;
+
+    synced = 1;
+    setLED(0x04);
+
+    // GERMAN TIME, CEST OR CET, THE CLOCK KEEPS ITS ZONE
+    setClockZone(time->day, time->month, time->year, time->hour, time->minute, 0, time->summer ? 120 : 60);
+
+    // SECOND 0 STARTED AT THE MINUTE MARK, NOT NOW. A FRAME COMPLETED BY THE FLYWHEEL OF
+    // THE SOFT DECODER WITHOUT A MARK IS NO TIME REFERENCE, THE CLOCK KEEPS ITS TICKS
+    if(markEvent) {
+        syncClock(osEventTime);
+#ifdef CLOCKDISCIPLINE
+        disciplineClock(osEventTime);
+#endif
     }
 
-    // CHECK VALID PARITY AND RETURN 0 OR 1
-    if(counter % 2 != 0) return 1;
-    return 0;
+    // LEAP SECOND AT THE END OF THIS HOUR. THE FRAME OF MINUTE 00 COMES AFTER IT
+    if(time->leap && time->minute != 0) {
+        leapClock();
+    }
 }
@@ -7,22 +7,30 @@
     Author:   W.Zimmermann, Sept 08, 2020
 */
 
+#include "dcf77Decoder.h"                       // DCF77EVENT and the decoder
+#include "os.h"                                 // osQueue
 
-// Data type for DCF77 signal events
-typedef enum { NODCF77EVENT=0, VALIDZERO, VALIDONE, VALIDSECOND, VALIDMINUTE, INVALID } DCF77EVENT;
-
-// Global variable holding the last DCF77 event
-extern DCF77EVENT dcf77Event;
+// Queue of the DCF77 events, each with the tickerTimestamp() of its detection
+extern osQueue dcf77Queue;
+extern DCF77DECODER dcf77Decoder;
+#if defined(DCF77OVERSAMPLE) && !defined(DCF77CAPTURE)
+extern unsigned long dcf77EdgeOverflows;        // Edges lost by isrECT6, see dcf77.c
+#endif
 
 // Public functions, for details see dcf77.c
 void initDCF77(void);
-DCF77EVENT sampleSignalDCF77(int currentTime);
-void processEventsDCF77(DCF77EVENT event);
+DCF77EVENT sampleSignalDCF77(void);
+void processEventsDCF77(osEvent event);
 
 // Prototypes of functions simulation DCF77 signals, when testing without
 // a DCF77 radio signal receiver
 void initializePortSim(void);                   // Use instead of initializePort() for simulator testing
+void initializeCapture(void);                   // Use instead of initializePort() for input capture mode
+void initializeOversampling(void);              // Additionally for oversampling mode
 char readPortSim(void);                         // Use instead of readPort() for simulator testing
-void decodeDateTime();
-int checkParity(int, int);
-void setLeapYear(int);
\ No newline at end of file
+char readPortSim1ms(void);                      // Same, but called every 1ms for oversampling
+#ifdef HOST
+extern int simScenario;                         // Changeover scenario of the host simulation, see dcf77Sim.c
+extern int simHoldover;                         // Hours without signal in scenario 4, see dcf77Sim.c
+void printScenarioSim(void);
+#endif
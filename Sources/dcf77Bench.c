@@ -0,0 +1,587 @@
+/*  Host benchmarks for the DCF77 decoder
+
+    Computerarchitektur / Computer Architecture
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
+    Hochschule Esslingen
+
+    Only used for the host build (compiler flag HOST), not part of the target build.
+
+    Generates DCF77 signals for consecutive minutes with encodeDecoderDCF77()
+    and pushes them through decoders, see dcf77Decoder.c. Called by hostMain.c.
+
+    Channel model for the time to sync: The falling edges are exact, the width of
+    each low pulse gets gaussian noise. The standard deviation is chosen such that
+    the given fraction of pulses is closer to the other bit value, i.e. crosses
+    150ms (bit error rate). Build once with and once without -DDCF77SOFT to compare.
+
+    Predicted frame matching: Each pulse is swapped between 100 and 200ms with the
+    given bit error rate. Two decoders with a clock each receive the same signal,
+    one with prediction from its clock, one with parity check only. Every hour both
+    clocks are set off by some minutes to measure the time to resync.
+
+    Burst errors: Every minute, a burst of the given length starts at a random time.
+    During the burst, each 10ms sample of the signal toggles with a probability of
+    30%. Measures the time to the first correct fix, build once with and once without
+    -DDCF77STITCH to compare.
+
+    Skewed receiver: All low pulses are lengthened by the given skew, which may be
+    negative, plus a slow AGC wander of +-SKEWWANDER ms with a period of 10 minutes
+    and gaussian jitter of SKEWJITTER ms. Measures the classification error rate of
+    the pulses, build once with and once without -DDCF77ADAPTIVE to compare.
+
+    Oversampling: The signal is rendered in 1ms samples, each sample is inverted
+    with the given probability (spikes). One decoder gets every 10th sample as
+    before, the other one the edges of the 1ms samples after filterDecoderDCF77(),
+    as isrECT6 in dcf77.c. Prints the pulse error rates and the host run time of
+    one filter step and of one 10ms sample step.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "dcf77Decoder.h"
+#include "halHost.h"
+
+// Defines
+#define BENCHPERIOD     10                      // Sampling period in ms
+#define BENCHMINUTES    60                      // Minutes in the sample buffer
+#define BENCHSAMPLES    (60 * 1000 / BENCHPERIOD)   // Samples per minute
+#define SYNCTRIALS      200                     // Trials of the time to sync benchmark
+#define SYNCMAXMINUTES  60                      // Give up after one hour
+#define MATCHMINUTES    100000                  // Minutes of the prediction benchmark
+#define BURSTTOGGLE     30                      // Toggle probability of a burst sample in percent
+#define SKEWMINUTES     1000                    // Minutes of the skewed receiver benchmark
+#define SKEWWANDER      20.0                    // Amplitude of the AGC wander in ms
+#define SKEWJITTER      10.0                    // Standard deviation of the jitter in ms
+#define OVERMINUTES     1000                    // Minutes of the oversampling benchmark
+#define OVERSAMPLES     60000                   // 1ms samples per minute
+#define OVEREDGES       4                       // Edges per 10ms batch, see SAMPLEEDGES in dcf77.c
+
+static unsigned long benchFrames;               // Frames reported by the decoder
+static DCF77TIME benchLast;                     // Last decoded time
+
+// Frame ready function of the benchmark decoders
+static void benchFrameReady(DCF77DECODER *decoder, const DCF77TIME *time)
+{   (void) decoder;
+    benchFrames++;
+    benchLast = *time;
+}
+
+// Advance the time by one minute, days only run from 1 to 28
+static void benchNextMinute(DCF77TIME *time)
+{   if (++time->minute < 60)
+        return;
+    time->minute = 0;
+    if (++time->hour < 24)
+        return;
+    time->hour = 0;
+    time->weekday = (char) (time->weekday % 7 + 1);
+    if (++time->day <= 28)
+        return;
+    time->day = 1;
+    if (++time->month <= 12)
+        return;
+    time->month = 1;
+    time->year++;
+}
+
+// Low pulse width in ms of second s of a frame, 0 for the minute gap
+static int benchPulse(const unsigned char *frame, int s)
+{   if (s >= DCF77FRAMEBITS)
+        return 0;
+    return (frame[s >> 3] & (1 << (s & 7))) ? 200 : 100;
+}
+
+// Render one minute of samples, starting at second 0
+static void benchRender(char *samples, const DCF77TIME *time)
+{   unsigned char frame[DCF77FRAMEBYTES];
+    int s, k, width;
+
+    encodeDecoderDCF77(frame, time);
+    for (s = 0; s < 60; s++)
+    {   width = benchPulse(frame, s);
+        for (k = 0; k < 1000 / BENCHPERIOD; k++)
+            *samples++ = (char) (k * BENCHPERIOD >= width);
+    }
+}
+
+static double benchSeconds(const struct timespec *start)
+{   struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+// Host function: benchDCF77 ... Push minutes of ideal signal through the decoder,
+// once as 10ms samples and once as edges, and print the throughput
+void benchDCF77(unsigned long minutes)
+{   static char samples[BENCHMINUTES * BENCHSAMPLES];
+    DCF77TIME time = { 0, 12, 1, 2, 3, 2020, 0, 0, 0 };
+    DCF77DECODER decoder;
+    unsigned char frame[DCF77FRAMEBYTES];
+    struct timespec start;
+    unsigned long m, t, edges;
+    double wall;
+    int i, s, width;
+
+    // SAMPLES: THE BUFFER IS RENDERED ONCE AND PUSHED AGAIN AND AGAIN,
+    // THE DECODED MINUTES REPEAT EVERY BENCHMINUTES MINUTES
+    for (i = 0; i < BENCHMINUTES; i++)
+    {   benchRender(&samples[i * BENCHSAMPLES], &time);
+        benchNextMinute(&time);
+    }
+    initDecoderDCF77(&decoder, 1000, benchFrameReady);
+    benchFrames = 0;
+    t = 1000;                                   // The first minute marker needs a previous second
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (m = 0; m < minutes; m += BENCHMINUTES)
+    {   i = minutes - m < BENCHMINUTES ? (int) (minutes - m) : BENCHMINUTES;
+        (void) pushSamplesDecoderDCF77(&decoder, samples, i * BENCHSAMPLES, t, BENCHPERIOD);
+        t += (unsigned long) i * 60000UL;
+    }
+    wall = benchSeconds(&start);
+    printf("Samples:           %lu minutes, %lu frames, %.3f s, %.1f Msamples/s (%.0f x real time)\n",
+           minutes, benchFrames, wall, minutes * (double) BENCHSAMPLES / wall * 1e-6,
+           minutes * 60.0 / wall);
+
+    // EDGES: TIME STAMPS IN TIMER COUNTS LIKE IN THE INPUT CAPTURE MODE
+    time.minute = 0;
+    initDecoderDCF77(&decoder, 187500UL, benchFrameReady);
+    benchFrames = 0;
+    edges = 0;
+    t = 187500UL;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (m = 0; m < minutes; m++)
+    {   encodeDecoderDCF77(frame, &time);
+        for (s = 0; s < 60; s++, t += 187500UL)
+        {   width = benchPulse(frame, s);
+            if (width)
+            {   (void) eventDecoderDCF77(&decoder, edgeDecoderDCF77(&decoder, 0, t));
+                (void) eventDecoderDCF77(&decoder, edgeDecoderDCF77(&decoder, 1, t + (unsigned long) width * 375 / 2));
+                edges += 2;
+            }
+        }
+        benchNextMinute(&time);
+    }
+    wall = benchSeconds(&start);
+    printf("Edges:             %lu minutes, %lu frames, %.3f s, %.1f Medges/s (%.0f x real time)\n",
+           minutes, benchFrames, wall, edges / wall * 1e-6, minutes * 60.0 / wall);
+    printf("Last frame:        %02d:%02d %02d.%02d.%04d weekday %d\n", benchLast.hour, benchLast.minute,
+           benchLast.day, benchLast.month, benchLast.year, benchLast.weekday);
+}
+
+static DCF77TIME syncExpect;                    // Time of the last complete frame
+static int syncResult;                          // 1: correct time decoded, -1: wrong time
+
+// Frame ready function of the time to sync benchmark
+static void syncFrameReady(DCF77DECODER *decoder, const DCF77TIME *time)
+{   (void) decoder;
+    if (syncResult)
+        return;
+    syncResult = (time->minute == syncExpect.minute && time->hour == syncExpect.hour &&
+                  time->day == syncExpect.day && time->weekday == syncExpect.weekday &&
+                  time->month == syncExpect.month && time->year == syncExpect.year) ? 1 : -1;
+}
+
+// Standard normal random number (Box-Muller)
+static double syncGauss(void)
+{   double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+}
+
+// Host function: benchSyncDCF77 ... Measure the time to sync for a bit error rate
+void benchSyncDCF77(double ber)
+{   static double seconds[SYNCTRIALS];
+    DCF77DECODER decoder;
+    DCF77TIME time;
+    unsigned char frame[DCF77FRAMEBYTES];
+    double sigma, lo = 0.0, hi = 10.0, width, sum = 0.0;
+    unsigned long t, start, pulses = 0, errors = 0;
+    int trial, m, s, nominal, synced = 0, wrong = 0, i, j;
+
+    // STANDARD DEVIATION: P(NOISE > 50MS) = BER, BISECTION ON THE NORMAL DISTRIBUTION
+    for (i = 0; i < 60; i++)
+    {   sigma = (lo + hi) / 2;
+        if (0.5 * erfc(sigma / sqrt(2.0)) > ber) lo = sigma; else hi = sigma;
+    }
+    sigma = ber > 0 ? 50.0 / lo : 0.0;
+
+    for (trial = 0; trial < SYNCTRIALS; trial++)
+    {   time.year = 2020; time.month = 3; time.day = 10; time.weekday = 2;
+        time.hour = (char) (rand() % 24);
+        time.minute = (char) (rand() % 60);
+        initDecoderDCF77(&decoder, 1000, syncFrameReady);
+        syncResult = 0;
+        start = t = 100000UL + (unsigned long) (rand() % 60000);    // Start anywhere in the minute
+        s = (int) ((t / 1000) % 60);
+        t = t / 1000 * 1000;
+        for (m = 0; m < SYNCMAXMINUTES && !syncResult; m++)
+        {   encodeDecoderDCF77(frame, &time);
+            for (; s < 60 && !syncResult; s++, t += 1000)
+            {   nominal = benchPulse(frame, s);
+                if (!nominal)
+                    continue;
+                width = nominal + sigma * syncGauss();
+                pulses++;
+                if ((width > 150.0) != (nominal > 150))
+                    errors++;
+                if (width < 5.0) width = 5.0;
+                if (width > 800.0) width = 800.0;
+                (void) eventDecoderDCF77(&decoder, edgeDecoderDCF77(&decoder, 0, t));
+                (void) eventDecoderDCF77(&decoder, edgeDecoderDCF77(&decoder, 1, t + (unsigned long) width));
+            }
+            s = 0;
+            syncExpect = time;                  // Decoded at the next minute marker
+            benchNextMinute(&time);
+        }
+        if (syncResult > 0)
+        {   seconds[synced++] = (t - start) / 1000.0;
+            sum += (t - start) / 1000.0;
+        } else if (syncResult < 0)
+        {   wrong++;
+        }
+    }
+
+    // MEDIAN BY INSERTION SORT
+    for (i = 1; i < synced; i++)
+        for (j = i; j > 0 && seconds[j-1] > seconds[j]; j--)
+        {   width = seconds[j]; seconds[j] = seconds[j-1]; seconds[j-1] = width;
+        }
+#ifdef DCF77SOFT
+    printf("Decoder:           soft decision, threshold %d\n", DCF77SOFTTHRESHOLD);
+#else
+    printf("Decoder:           frame by frame\n");
+#endif
+    printf("Bit error rate:    %.4f requested, %.4f measured, width noise %.1f ms\n",
+           ber, pulses ? (double) errors / pulses : 0.0, sigma);
+    printf("Synced:            %d of %d trials within %d minutes, %d wrong times\n",
+           synced, SYNCTRIALS, SYNCMAXMINUTES, wrong);
+    if (synced)
+        printf("Time to sync:      mean %.0f s, median %.0f s, max %.0f s\n",
+               sum / synced, seconds[synced / 2], seconds[synced - 1]);
+}
+
+// Clock of the prediction benchmark, set by the frame ready function
+typedef struct
+{   DCF77DECODER decoder;                       // Must be the first member, see matchFrameReady()
+    DCF77TIME clock;                            // Clock time, the minute of the last minute marker
+    unsigned long accepted, wrong;              // Frames accepted, with a wrong time
+    unsigned long confirmed, confirmSum;        // Confirmed predictions, sum of their bit positions
+    unsigned long diverged;                     // Diverged predictions
+    unsigned long resyncs, minutesOff;          // Clock errors, minutes with a wrong clock
+} MATCHCLOCK;
+
+static DCF77TIME matchTrue;                     // Time of the last complete frame
+
+static void matchFrameReady(DCF77DECODER *decoder, const DCF77TIME *time)
+{   MATCHCLOCK *clock = (MATCHCLOCK *) decoder;
+
+    clock->accepted++;
+    if (time->minute != matchTrue.minute || time->hour != matchTrue.hour || time->day != matchTrue.day ||
+        time->month != matchTrue.month || time->year != matchTrue.year)
+        clock->wrong++;
+    clock->clock = *time;
+}
+
+// Push an edge into the decoder and keep the statistics
+static void matchEdge(MATCHCLOCK *clock, char signal, unsigned long t)
+{   int result = eventDecoderDCF77(&clock->decoder, edgeDecoderDCF77(&clock->decoder, signal, t));
+
+    if (result == 2)
+    {   clock->confirmed++;
+        clock->confirmSum += clock->decoder.position;
+    } else if (result == -2)
+    {   clock->diverged++;
+    }
+}
+
+// Host function: benchMatchDCF77 ... Compare predicted frame matching and parity check only
+void benchMatchDCF77(double ber)
+{   static MATCHCLOCK clocks[2];                // 0: parity only, 1: prediction
+    DCF77TIME time = { 0, 12, 1, 2, 3, 2020, 0, 0, 0 }, next;
+    unsigned char frame[DCF77FRAMEBYTES];
+    unsigned long t = 1000, m;
+    int c, s, width;
+
+    for (c = 0; c < 2; c++)
+    {   initDecoderDCF77(&clocks[c].decoder, 1000, matchFrameReady);
+        clocks[c].clock = time;
+    }
+    for (m = 0; m < MATCHMINUTES; m++)
+    {   encodeDecoderDCF77(frame, &time);
+        for (s = 0; s < 60; s++, t += 1000)
+        {   width = benchPulse(frame, s);
+            if (!width)
+                continue;
+            if (rand() < ber * ((double) RAND_MAX + 1.0))
+                width = 300 - width;
+            for (c = 0; c < 2; c++)
+            {   if (s == 0)                     // Minute marker: the clock runs on, a valid frame sets it
+                    advanceDecoderDCF77(&clocks[c].clock, 1);
+                matchEdge(&clocks[c], 0, t);
+                if (s == 0 && m > 0)
+                {   DCF77TIME *k = &clocks[c].clock;
+                    if (k->minute != matchTrue.minute || k->hour != matchTrue.hour ||
+                        k->day != matchTrue.day || k->month != matchTrue.month)
+                        clocks[c].minutesOff++;
+                    if (m % 60 == 30)           // Set the clock off every hour
+                    {   advanceDecoderDCF77(k, 1 + rand() % 30);
+                        clocks[c].resyncs++;
+                    }
+                    if (c == 1)                 // Predict the frame starting now
+                    {   next = *k;
+                        advanceDecoderDCF77(&next, 1);
+                        predictDecoderDCF77(&clocks[c].decoder, &next);
+                    }
+                }
+                matchEdge(&clocks[c], 1, t + (unsigned long) width);
+            }
+        }
+        matchTrue = time;                       // Decoded at the next minute marker
+        benchNextMinute(&time);
+    }
+
+    printf("Bit error rate:    %.4f, %d minutes, match after %d bits\n", ber, MATCHMINUTES, DCF77MATCHBITS);
+    for (c = 0; c < 2; c++)
+    {   printf("%s accepted %lu, wrong %lu (%.2f per 1000), %.2f minutes off per resync",
+               c ? "Prediction: " : "Parity only:", clocks[c].accepted, clocks[c].wrong,
+               clocks[c].accepted ? 1000.0 * clocks[c].wrong / clocks[c].accepted : 0.0,
+               clocks[c].resyncs ? (double) clocks[c].minutesOff / clocks[c].resyncs : 0.0);
+        if (c)
+            printf(",\n             confirmed %lu at bit %.1f, diverged %lu", clocks[c].confirmed,
+                   clocks[c].confirmed ? (double) clocks[c].confirmSum / clocks[c].confirmed : 0.0,
+                   clocks[c].diverged);
+        printf("\n");
+    }
+}
+
+// Host function: benchBurstDCF77 ... Measure the time to the first fix with a burst
+// error of the given length in seconds in every minute
+void benchBurstDCF77(int burst)
+{   static char samples[BENCHSAMPLES];
+    static double seconds[SYNCTRIALS];
+    DCF77DECODER decoder;
+    DCF77TIME time;
+    double sum = 0.0, x;
+    unsigned long t, start;
+    int trial, m, k, first, spill, length, synced = 0, wrong = 0, i, j;
+    char level;
+
+    length = burst * (1000 / BENCHPERIOD);
+    if (length > BENCHSAMPLES - 1000 / BENCHPERIOD)
+        length = BENCHSAMPLES - 1000 / BENCHPERIOD;     // At most 59s per minute
+
+    for (trial = 0; trial < SYNCTRIALS; trial++)
+    {   time.year = 2020; time.month = 3; time.day = 10; time.weekday = 2;
+        time.hour = (char) (rand() % 24);
+        time.minute = (char) (rand() % 60);
+        initDecoderDCF77(&decoder, 1000, syncFrameReady);
+        syncResult = 0;
+        first = rand() % BENCHSAMPLES;                  // Start anywhere in the minute
+        start = t = 100000UL + (unsigned long) first * BENCHPERIOD;
+        spill = 0;
+        for (m = 0; m < SYNCMAXMINUTES && !syncResult; m++)
+        {   benchRender(samples, &time);
+
+            // BURST AT A RANDOM TIME, THE PART AFTER THE END OF THE MINUTE GOES TO THE NEXT ONE
+            level = samples[0];
+            for (k = 0; k < spill; k++)
+            {   if (rand() % 100 < BURSTTOGGLE) level ^= 1;
+                samples[k] = level;
+            }
+            k = rand() % BENCHSAMPLES;
+            spill = k + length - BENCHSAMPLES;
+            level = samples[k];
+            for (; k < BENCHSAMPLES && k < BENCHSAMPLES + spill; k++)
+            {   if (rand() % 100 < BURSTTOGGLE) level ^= 1;
+                samples[k] = level;
+            }
+            if (spill < 0) spill = 0;
+
+            // A BURST MAY FAKE THE MINUTE MARKER EARLY, THE EXPECTED TIME CHANGES IN THE MIDDLE
+            for (k = first; k < BENCHSAMPLES && !syncResult; k++, t += BENCHPERIOD)
+            {   if (k == BENCHSAMPLES / 2)
+                    syncExpect = time;
+                (void) eventDecoderDCF77(&decoder, sampleDecoderDCF77(&decoder, samples[k], t));
+            }
+            if (first > BENCHSAMPLES / 2)
+                syncExpect = time;
+            first = 0;
+            benchNextMinute(&time);
+        }
+        if (syncResult > 0)
+        {   seconds[synced++] = (t - start) / 1000.0;
+            sum += (t - start) / 1000.0;
+        } else if (syncResult < 0)
+        {   wrong++;
+        }
+    }
+
+    // MEDIAN BY INSERTION SORT
+    for (i = 1; i < synced; i++)
+        for (j = i; j > 0 && seconds[j-1] > seconds[j]; j--)
+        {   x = seconds[j]; seconds[j] = seconds[j-1]; seconds[j-1] = x;
+        }
+#if defined(DCF77SOFT)
+    printf("Decoder:           soft decision, threshold %d\n", DCF77SOFTTHRESHOLD);
+#elif defined(DCF77STITCH)
+    printf("Decoder:           partial frame stitching\n");
+#else
+    printf("Decoder:           frame by frame\n");
+#endif
+    printf("Burst:             %d s per minute, %d%% sample toggles\n", length / (1000 / BENCHPERIOD), BURSTTOGGLE);
+    printf("Synced:            %d of %d trials within %d minutes, %d wrong times\n",
+           synced, SYNCTRIALS, SYNCMAXMINUTES, wrong);
+    if (synced)
+        printf("Time to first fix: mean %.0f s, median %.0f s, max %.0f s\n",
+               sum / synced, seconds[synced / 2], seconds[synced - 1]);
+}
+
+// Host function: benchSkewDCF77 ... Measure the pulse classification error rate
+// of a receiver with asymmetric duty cycle, skew in ms
+void benchSkewDCF77(int skew)
+{   DCF77DECODER decoder;
+    DCF77TIME time = { 0, 12, 1, 2, 3, 2020, 0, 0, 0 };
+    unsigned char frame[DCF77FRAMEBYTES];
+    unsigned long t = 100000UL, pulses = 0, wrong = 0, invalid = 0;
+    double width;
+    int m, s, nominal;
+    DCF77EVENT event;
+
+    initDecoderDCF77(&decoder, 1000, 0);
+    for (m = 0; m < SKEWMINUTES; m++)
+    {   encodeDecoderDCF77(frame, &time);
+        for (s = 0; s < 60; s++, t += 1000)
+        {   nominal = benchPulse(frame, s);
+            if (!nominal)
+                continue;
+            width = nominal + skew + SKEWWANDER * sin(6.283185307179586 * t / 600000.0) + SKEWJITTER * syncGauss();
+            if (width < 5.0) width = 5.0;
+            if (width > 800.0) width = 800.0;
+            (void) edgeDecoderDCF77(&decoder, 0, t);
+            event = edgeDecoderDCF77(&decoder, 1, t + (unsigned long) width);
+            pulses++;
+            if (event != VALIDZERO && event != VALIDONE)
+                invalid++;
+            else if ((event == VALIDONE) != (nominal > 150))
+                wrong++;
+        }
+        benchNextMinute(&time);
+    }
+
+#ifdef DCF77ADAPTIVE
+    printf("Classification:    adaptive, %.0f/%.0f ms at the end\n",
+           (double) (decoder.zeroSum >> 3), (double) (decoder.oneSum >> 3));
+#else
+    printf("Classification:    fixed windows\n");
+#endif
+    printf("Receiver:          skew %d ms, AGC wander +-%.0f ms, jitter %.0f ms\n", skew, SKEWWANDER, SKEWJITTER);
+    printf("Pulses:            %lu, %lu wrong, %lu invalid, error rate %.5f\n",
+           pulses, wrong, invalid, pulses ? (double) (wrong + invalid) / pulses : 0.0);
+}
+
+static DCF77DECODER *overFiltered;              // Decoder of the filtered 1ms samples
+static unsigned long overFrames[2];             // Frames of the 10ms and the 1ms decoder
+static unsigned long overCorrect[2];            // Correctly classified pulses
+static unsigned long overInvalid[2];            // Invalid events
+static int overSecond[2];                       // Second of the last correct pulse
+
+// Frame ready function of the oversampling benchmark
+static void overFrameReady(DCF77DECODER *decoder, const DCF77TIME *time)
+{   (void) time;
+    overFrames[decoder == overFiltered]++;
+}
+
+// Check a pulse event of second s against the frame, count correct pulses once
+// per second and invalid events, i = 0 for the 10ms and 1 for the 1ms decoder
+static void overCheck(int i, DCF77EVENT event, const unsigned char *frame, int s)
+{   if (event == INVALID)
+        overInvalid[i]++;
+    if ((event != VALIDZERO && event != VALIDONE) || s == overSecond[i])
+        return;
+    if ((event == VALIDONE) == (benchPulse(frame, s) > 150))
+    {   overCorrect[i]++;
+        overSecond[i] = s;
+    }
+}
+
+// Host function: benchOversampleDCF77 ... Compare 10ms sampling with 1ms oversampling
+// and glitch filter, rate is the probability of a spike per 1ms sample
+void benchOversampleDCF77(double rate)
+{   static char samples[OVERSAMPLES];
+    DCF77DECODER sampled, filtered;
+    DCF77FILTER filter;
+    DCF77TIME time = { 0, 12, 1, 2, 3, 2020, 0, 0, 0 };
+    unsigned char frame[DCF77FRAMEBYTES];
+    unsigned long t, start = 100000UL, pulses = 0, steps = 0, overflows = 0;
+    double wallFilter, wallSample;
+    struct timespec begin;
+    volatile char sink;
+    int m, s, k, width, edges = 0, maxEdges = 0, threshold = (int) (rate * RAND_MAX);
+    char level;
+    DCF77EVENT event;
+
+    overFiltered = &filtered;
+    for (k = 0; k < 2; k++)
+        overFrames[k] = overCorrect[k] = overInvalid[k] = 0;
+    initDecoderDCF77(&sampled, 1000, overFrameReady);
+    initDecoderDCF77(&filtered, 1000, overFrameReady);
+    initFilterDecoderDCF77(&filter);
+    level = 1;
+    for (m = 0; m < OVERMINUTES; m++, start += 60000UL)
+    {   encodeDecoderDCF77(frame, &time);
+        for (s = 0; s < 60; s++)
+        {   width = benchPulse(frame, s);
+            for (k = 0; k < 1000; k++)
+                samples[s * 1000 + k] = (char) ((k >= width) ^ (rand() < threshold));
+        }
+        pulses += DCF77FRAMEBITS;
+        overSecond[0] = overSecond[1] = -1;
+
+        for (k = 0, t = start; k < OVERSAMPLES; k += 10, t += 10)
+        {   event = sampleDecoderDCF77(&sampled, samples[k], t);
+            overCheck(0, event, frame, k / 1000);
+            (void) eventDecoderDCF77(&sampled, event);
+        }
+        for (k = 0, t = start; k < OVERSAMPLES; k++, t++)
+        {   if (k % 10 == 0)
+            {   if (edges > maxEdges) maxEdges = edges;
+                if (edges > OVEREDGES) overflows++;
+                edges = 0;
+            }
+            if (filterDecoderDCF77(&filter, samples[k]) == level)
+                continue;
+            level = (char) !level;
+            edges++;
+            event = edgeDecoderDCF77(&filtered, level, t);
+            overCheck(1, event, frame, k / 1000);
+            (void) eventDecoderDCF77(&filtered, event);
+        }
+        benchNextMinute(&time);
+    }
+
+    // RUN TIME OF ONE INTERRUPT STEP AND ONE 10MS SAMPLE STEP, SAME SAMPLES
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (m = 0; m < 100; m++)
+        for (k = 0; k < OVERSAMPLES; k++)
+            sink = filterDecoderDCF77(&filter, samples[k]);
+    wallFilter = benchSeconds(&begin) / (100.0 * OVERSAMPLES);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (m = 0, t = start; m < 100; m++)
+        for (k = 0; k < OVERSAMPLES; k += 10, t += 10, steps++)
+            sink = (char) sampleDecoderDCF77(&sampled, samples[k], t);
+    wallSample = benchSeconds(&begin) / steps;
+    (void) sink;
+
+    printf("Spikes:            %.4f per 1ms sample, %lu minutes, %lu pulses\n", rate, (unsigned long) OVERMINUTES, pulses);
+    for (k = 0; k < 2; k++)
+        printf("%s %lu frames, pulse error rate %.5f, %lu invalid events\n", k ? "1ms oversampling: " : "10ms sampling:    ",
+               overFrames[k], 1.0 - (double) overCorrect[k] / pulses, overInvalid[k]);
+    printf("Edges per 10ms:    max %d, %lu batches over %d\n", maxEdges, overflows, OVEREDGES);
+    printf("Host run time:     filter %.1f ns per 1ms, sampling %.1f ns per 10ms, %.2f us/s vs %.2f us/s\n",
+           wallFilter * 1e9, wallSample * 1e9, wallFilter * 1e9, wallSample * 1e8);
+}
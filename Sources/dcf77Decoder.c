@@ -0,0 +1,1282 @@
+/*  Radio signal clock - DCF77 Decoder
+
+    Computerarchitektur / Computer Architecture
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
+    Hochschule Esslingen
+
+    Streaming decoder for the DCF77 signal without any hardware access or module
+    globals. All state is kept in a DCF77DECODER variable, so several decoders
+    can run side by side and a decoder can be driven from recorded or generated data.
+
+    The signal is pushed into the decoder either as samples, see sampleDecoderDCF77(),
+    or as time stamped edges, see edgeDecoderDCF77(). Both classify the pulses and
+    return the DCF77 event. The events are then assembled into the minute frame by
+    eventDecoderDCF77(), which calls the frame ready function for each complete frame
+    with valid parity. The firmware calls the classification in interrupt context and
+    the frame assembly in the DCF77 task, see dcf77.c. pushSamplesDecoderDCF77() does
+    both for a block of samples.
+
+    Oversampled signals can be deglitched by filterDecoderDCF77() before they are
+    pushed into the decoder.
+
+    Predicted frame matching: Once the clock is synchronized, the user calls
+    predictDecoderDCF77() after each minute marker with the time expected in the
+    frame, which is just starting. The decoder compares the time information bits
+    20..58 with the prediction as they arrive. eventDecoderDCF77() reports the first
+    mismatch immediately and confirms the prediction after matchRequired matching
+    bits. A complete frame, which diverged from the prediction, is only accepted,
+    if the next frame follows it by one minute, so single frames with an even number
+    of bit errors in a parity group are no longer accepted.
+
+    Changeovers: The bits 16 and 19 announce a change between CET and CEST and a
+    leap second for the end of the hour. advanceDecoderDCF77() shifts the hour at an
+    announced change, so a frame after the change still follows the one before.
+    The frame, which encodes minute 00 with bit 19 set, is transmitted in a minute of
+    61 seconds: second 59 is an additional 0 bit, the marker follows second 60. The
+    decoder expects this marker from the minute field on, see leapMinute.
+
+    Compiler flags:
+    DCF77SOFT   Soft decision decoding over several minutes instead of the frame
+                by frame decoding, see below
+    DCF77STITCH Stitch the time from partial frames of several minutes, see below.
+                Has no effect together with DCF77SOFT.
+    DCF77ADAPTIVE   Pulse width thresholds follow the receiver, see below
+
+    Adaptive pulse width classification (compiler flag DCF77ADAPTIVE):
+    Receivers with an asymmetric duty cycle lengthen or shorten all low pulses, so
+    they may fall outside of the fixed 0 and 1 windows. The widths of all plausible
+    low pulses (20..400ms) are clustered online by two running means. Each pulse,
+    which starts a valid second, updates the mean on its side of the middle between
+    them, so glitches do not disturb the means. If one cluster gets less
+    than 1/8 of the pulses of a window of ADAPTWINDOW pulses, both means start again at
+    the shortest and the longest pulse of the window. A pulse is a 0 or a 1, if it is on the respective side of the middle,
+    but outside of a dead band of 1/8 of the distance of the means around the middle
+    (hysteresis) and less than half of the distance beyond its mean. The fixed windows
+    are used until both clusters got DCF77ADAPTLOCK pulses, and again after a reset,
+    if the means come closer than 50ms. The distances of the falling edges are not
+    affected by the duty cycle, so the second and minute windows stay fixed.
+
+    Partial frame stitching (compiler flag DCF77STITCH):
+    After the first minute marker, the seconds are derived from the marker time like
+    for the soft decoding. Each bit is stored at the position of its second together
+    with a valid flag, an invalid pulse only discards the bit of its own second and a
+    missed minute marker is bridged. At the end of each minute, a minute field with
+    valid parity is kept together with the minute it belongs to, and the valid hour and
+    date bits are merged into a stitched frame. Merged bits, which differ from the new
+    ones or belong to a previous hour, are dropped. As soon as the stitched hour and
+    date bits are complete with valid parity and a minute field is known, the minute
+    is advanced by the minutes elapsed since it was received and the time is decoded.
+    With a clean signal, the time is decoded after one minute like before.
+
+    Soft decision decoding (compiler flag DCF77SOFT):
+    Invalid pulses do not discard the minute. After the first minute marker, the
+    seconds are derived from the marker time (flywheel), missed markers are bridged.
+    The confidence of each bit is the low time of the signal in the 100..200ms window
+    of its second, -100 for always high (0) to +100 for always low (1), 0 if the
+    second did not start with a falling edge. At every minute marker, the confidences
+    of the hour and date bits are added up, a new hour restarts the sums. For the
+    minute, every value 0..59 gets a score, which is the correlation of the minute
+    bits with its code plus the score of the value one less in the previous minute.
+    The time is accepted, when every hour and date bit has a confidence sum of at
+    least softThreshold, the best minute value leads by twice that and the parity
+    and value ranges are valid. With a clean signal, this is the case after one
+    minute like before.
+*/
+
+#include "dcf77Decoder.h"
+
+// Parity of a byte, built up from the parity of its 2-, 4- and 6-bit prefixes
+#define P2(n)       n, n^1, n^1, n
+#define P4(n)       P2(n), P2(n^1), P2(n^1), P2(n)
+#define P6(n)       P4(n), P4(n^1), P4(n^1), P4(n)
+
+// Glitch filter: majority of the last FILTERBITS samples with hysteresis
+#define FILTERBITS  5                           // Samples in the majority window
+#define FILTERHIGH  4                           // Ones in the window to switch to high
+#define FILTERLOW   1                           // Ones in the window to switch to low
+
+/* ********** MODULE CONSTANTS **********
+ * parityTable[]:   Parity (1 = odd number of ones) of all byte values
+ * bcdTens[]:       Binary value of the BCD tens digit, also for invalid digits
+ * onesTable[]:     Number of ones of all FILTERBITS bit values
+*/
+static const unsigned char parityTable[256] = { P6(0), P6(1), P6(1), P6(0) };
+static const unsigned char bcdTens[16] = { 0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100, 110, 120, 130, 140, 150 };
+static const unsigned char onesTable[1 << FILTERBITS] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                          1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5 };
+
+#ifndef DCF77SOFT
+#ifndef DCF77STITCH
+static int decodeFrame(DCF77DECODER *decoder);
+#endif
+static int acceptTime(DCF77DECODER *decoder, const DCF77TIME *time);
+#endif
+static int checkParity(const unsigned char *frame, int startIndex, int endIndex);
+static unsigned char getField(const unsigned char *frame, int start, int length);
+static unsigned char getBCD(const unsigned char *frame, int start, int length);
+static void putField(unsigned char *frame, int start, int length, unsigned char value);
+static void putBCD(unsigned char *frame, int start, int length, unsigned char value);
+static void zoneTime(DCF77DECODER *decoder, DCF77TIME *time);
+static int matchBit(DCF77DECODER *decoder, int position);
+static int validTime(const DCF77TIME *time);
+#ifndef DCF77SOFT
+static int sameTime(const DCF77TIME *a, const DCF77TIME *b);
+#endif
+#ifdef DCF77SOFT
+#define SOFTNONE    (-128)                      // Second did not start with a falling edge
+#define SOFTMAX     1000                        // Limit of the confidence sums
+
+static void softRestart(DCF77DECODER *decoder);
+static void softMinute(DCF77DECODER *decoder);
+static void softFlywheel(DCF77DECODER *decoder, unsigned long time);
+static void softEdge(DCF77DECODER *decoder, char signal, unsigned long time, DCF77EVENT event);
+static int softDecode(DCF77DECODER *decoder);
+#endif
+#ifdef DCF77ADAPTIVE
+#define ADAPTWINDOW 32                          // Pulses of the window to detect an empty cluster
+
+static DCF77EVENT adaptPulse(DCF77DECODER *decoder, unsigned long width, DCF77EVENT event);
+static int adaptUpdate(DCF77DECODER *decoder, unsigned long width, char side);
+static void adaptRestart(DCF77DECODER *decoder);
+#endif
+#ifdef DCF77STITCH
+static DCF77EVENT stitchEdge(DCF77DECODER *decoder, unsigned long time, DCF77EVENT event);
+static void stitchRestart(DCF77DECODER *decoder);
+static int stitchFrame(DCF77DECODER *decoder, int elapsed);
+#endif
+
+
+/* ********** FUNCTION: initDecoderDCF77(...) **********
+ * Description:     Initialize a decoder. The classification windows are 70..130ms for
+ *                  a zero, 170..230ms for a one, 900..1100ms for a second and
+ *                  1900..2100ms for the minute marker.
+ * Parameter:       DCF77DECODER *decoder
+ *                  unsigned long unitsPerSecond    time unit of the samples or edges,
+ *                                                  e.g. 1000 for milliseconds, max. 2000000
+ *                  frameReady                      called for each valid frame, may be 0
+ * Return:          -
+ */
+void initDecoderDCF77(DCF77DECODER *decoder, unsigned long unitsPerSecond,
+                      void (*frameReady)(DCF77DECODER *decoder, const DCF77TIME *time)) {
+    int i;
+
+    decoder->zeroMin   = unitsPerSecond * 70 / 1000;
+    decoder->zeroMax   = unitsPerSecond * 130 / 1000;
+    decoder->oneMin    = unitsPerSecond * 170 / 1000;
+    decoder->oneMax    = unitsPerSecond * 230 / 1000;
+    decoder->secondMin = unitsPerSecond * 900 / 1000;
+    decoder->secondMax = unitsPerSecond * 1100 / 1000;
+    decoder->minuteMin = unitsPerSecond * 1900 / 1000;
+    decoder->minuteMax = unitsPerSecond * 2100 / 1000;
+
+    decoder->lastFalling = 0;
+    decoder->lastSignal = 1;
+#ifdef DCF77ADAPTIVE
+    decoder->pulseMin   = unitsPerSecond * 20 / 1000;
+    decoder->pulseMax   = unitsPerSecond * 400 / 1000;
+    decoder->gapMin     = unitsPerSecond * 50 / 1000;
+    decoder->gapNominal = unitsPerSecond * 100 / 1000;
+    adaptRestart(decoder);
+#endif
+    for(i = 0; i < DCF77FRAMEBYTES; i++) {
+        decoder->frame[i] = 0;
+    }
+    decoder->position = 0;
+    decoder->invalid = 0;
+    decoder->prediction = PREDICTNONE;
+    decoder->matches = 0;
+    decoder->matchRequired = DCF77MATCHBITS;
+    decoder->pendingValid = 0;
+    decoder->summer = 0;
+    decoder->leapMinute = 0;
+    decoder->frameReady = frameReady;
+
+#if defined(DCF77SOFT) || defined(DCF77STITCH)
+    decoder->unitsPerSecond = unitsPerSecond;
+    decoder->anchored = 0;
+#endif
+#ifdef DCF77STITCH
+    decoder->second = -1;
+    decoder->spoiled = -1;
+    decoder->elapsed = 0;
+    decoder->minutes = 0;
+    decoder->pendingIndex = 0;
+    for(i = 0; i < DCF77FRAMEBYTES; i++) {
+        decoder->valid[i] = 0;
+    }
+    stitchRestart(decoder);
+#endif
+#ifdef DCF77SOFT
+    decoder->bank = 0;
+    decoder->softFrames = 0;
+    decoder->softDone = 0;
+    decoder->softThreshold = DCF77SOFTTHRESHOLD;
+    softRestart(decoder);
+#endif
+}
+
+/* ********** FUNCTION: sampleDecoderDCF77(...) **********
+ * Description:     Classify a sample of the signal. An edge is assumed at the time of
+ *                  the first sample with the new level. Without edges for more than
+ *                  the minute marker window, every sample returns INVALID.
+ * Parameter:       DCF77DECODER *decoder
+ *                  char signal             sampled signal level, 0 or 1
+ *                  unsigned long time      time of the sample, may wrap around
+ * Return:          DCF77EVENT
+ */
+DCF77EVENT sampleDecoderDCF77(DCF77DECODER *decoder, char signal, unsigned long time) {
+#ifdef DCF77SOFT
+    softFlywheel(decoder, time);
+#endif
+
+    // CHECK IF THE SIGNAL HAS CHANGED - EDGE DETECTED
+    if(signal != decoder->lastSignal) {
+        return edgeDecoderDCF77(decoder, signal, time);
+    }
+
+    // ~NO EDGE: CHECK FOR SIGNAL LOSS
+    if(time - decoder->lastFalling >= decoder->minuteMax) {
+        return INVALID;
+    }
+    return NODCF77EVENT;
+}
+
+/* ********** FUNCTION: edgeDecoderDCF77(...) **********
+ * Description:     Classify an edge of the signal
+ * Parameter:       DCF77DECODER *decoder
+ *                  char signal             signal level after the edge, i.e. 1 for a rising edge
+ *                  unsigned long time      time of the edge, may wrap around
+ * Return:          DCF77EVENT
+ */
+DCF77EVENT edgeDecoderDCF77(DCF77DECODER *decoder, char signal, unsigned long time) {
+    DCF77EVENT event = INVALID;
+    unsigned long width = time - decoder->lastFalling;
+
+#ifdef DCF77SOFT
+    softFlywheel(decoder, time);
+#endif
+    decoder->lastSignal = signal;
+
+    // ~RISING EDGE: END OF THE LOW PULSE
+    if(signal) {
+        // CHECK FOR VALID ONE OR VALID ZERO
+        if(width >= decoder->oneMin && width <= decoder->oneMax) {
+            event = VALIDONE;
+        }
+        if(width >= decoder->zeroMin && width <= decoder->zeroMax) {
+            event = VALIDZERO;
+        }
+#ifdef DCF77ADAPTIVE
+        event = adaptPulse(decoder, width, event);
+#endif
+
+    // ~FALLING EDGE: START OF A SECOND
+    } else {
+        decoder->lastFalling = time;
+
+        // CHECK FOR VALID MINUTE OR VALID SECOND
+        if(width >= decoder->minuteMin && width <= decoder->minuteMax) {
+            event = VALIDMINUTE;
+        }
+        if(width >= decoder->secondMin && width <= decoder->secondMax) {
+            event = VALIDSECOND;
+        }
+#ifdef DCF77ADAPTIVE
+        decoder->secondStart = (char) (event != INVALID);
+#endif
+    }
+
+#ifdef DCF77SOFT
+    softEdge(decoder, signal, time, event);
+#endif
+#ifdef DCF77STITCH
+    if(!signal) event = stitchEdge(decoder, time, event);
+#endif
+    return event;
+}
+
+/* ********** FUNCTION: tagDecoderDCF77(...) **********
+ * Description:     Tag of an event, i.e. the classification state, which the frame
+ *                  assembly needs with DCF77STITCH: the second of a bit, the second
+ *                  discarded by INVALID or the minutes completed at VALIDMINUTE.
+ *                  Called right after the classification, in the same context. When
+ *                  the events are queued, the tag is queued with the event, because
+ *                  the classification state moves on meanwhile.
+ * Parameter:       DCF77DECODER *decoder
+ *                  DCF77EVENT event        result of the classification
+ * Return:          tag for taggedEventDecoderDCF77(), -1 without DCF77STITCH
+ */
+signed char tagDecoderDCF77(DCF77DECODER *decoder, DCF77EVENT event) {
+#ifdef DCF77STITCH
+    signed char tag;
+
+    switch(event) {
+        case INVALID:                                   // The discarded second is consumed
+            tag = decoder->spoiled;
+            decoder->spoiled = -1;
+            return tag;
+        case VALIDMINUTE:
+            return decoder->elapsed;
+        default:                                        // Set by the falling edge of the pulse
+            return decoder->second;
+    }
+#else
+    (void) decoder;
+    (void) event;
+    return -1;
+#endif
+}
+
+/* ********** FUNCTION: eventDecoderDCF77(...) **********
+ * Description:     Assemble the minute frame from an event, which was classified just
+ *                  before, e.g. by edgeDecoderDCF77(), see taggedEventDecoderDCF77()
+ * Parameter:       DCF77DECODER *decoder
+ *                  DCF77EVENT event
+ * Return:          see taggedEventDecoderDCF77()
+ */
+int eventDecoderDCF77(DCF77DECODER *decoder, DCF77EVENT event) {
+    return taggedEventDecoderDCF77(decoder, event, tagDecoderDCF77(decoder, event));
+}
+
+/* ********** FUNCTION: taggedEventDecoderDCF77(...) **********
+ * Description:     Assemble the minute frame from the events. At the minute marker
+ *                  after a complete frame, the frame is decoded and the frame ready
+ *                  function is called, if the parity is valid. With DCF77STITCH, the
+ *                  time may also be decoded from several partial frames.
+ *                  Does not read the classification state, so it can run later,
+ *                  e.g. in task context for queued events.
+ * Parameter:       DCF77DECODER *decoder
+ *                  DCF77EVENT event
+ *                  signed char tag         tag of the event, see tagDecoderDCF77(), DCF77TAGLOST
+ *                                          with INVALID -> events were lost before this one
+ * Return:          1 -> valid frame decoded
+ *                  -1 -> complete frame with invalid parity or not accepted
+ *                  2 -> prediction confirmed, see predictDecoderDCF77()
+ *                  -2 -> bit did not match the prediction
+ *                  0 -> otherwise
+ */
+int taggedEventDecoderDCF77(DCF77DECODER *decoder, DCF77EVENT event, signed char tag) {
+#ifdef DCF77STITCH
+    int position = tag;                                 // Second of the bit
+    int k;
+#else
+    int position = decoder->position;
+#endif
+    int result = 0;
+
+    (void) tag;
+
+#ifdef DCF77SOFT
+    // ACCUMULATE THE MINUTES COMPLETED IN CLASSIFICATION CONTEXT
+    if(decoder->lost) {
+        decoder->lost = 0;
+        softRestart(decoder);
+    }
+    if(decoder->softFrames != decoder->softDone) {
+        if((unsigned char) (decoder->softFrames - decoder->softDone) > 1) softRestart(decoder);
+        decoder->softDone = decoder->softFrames;
+        result = softDecode(decoder);
+    }
+#endif
+
+    switch(event){
+
+#ifdef DCF77STITCH
+        // CASE INVALID: DISCARD THE BIT OF A SECOND WITH AN ADDITIONAL EDGE. AFTER LOST EVENTS THE
+        // BITS AND MINUTES OF THE GAP ARE UNKNOWN: DROP ALL BITS AND RESTART THE MINUTE COUNT
+        case INVALID:
+            if(position == DCF77TAGLOST) {
+                for(k = 0; k < DCF77FRAMEBYTES; k++) {
+                    decoder->valid[k] = 0;
+                }
+                stitchRestart(decoder);
+                decoder->minutes = 0;
+                decoder->pendingIndex = 0;
+                decoder->pendingValid = 0;
+            } else if(position >= 0) {
+                decoder->valid[position >> 3] &= (unsigned char) ~(1 << (position & 7));
+            }
+            break;
+#else
+        // CASE INVALID: DISCARD THE FRAME UNTIL THE NEXT MINUTE MARKER
+        case INVALID:
+            decoder->invalid = 1;
+            decoder->position = 0;
+            break;
+#endif
+
+        // CASE VALIDZERO: CLEAR THE BIT IN THE FRAME
+        case VALIDZERO:
+            if(decoder->invalid == 0 && position >= 0 && position < DCF77FRAMEBITS) {
+                decoder->frame[position >> 3] &= (unsigned char) ~(1 << (position & 7));
+#ifdef DCF77STITCH
+                decoder->valid[position >> 3] |= (unsigned char) (1 << (position & 7));
+#endif
+                if(!result) result = matchBit(decoder, position);
+            }
+            break;
+
+        // CASE VALIDONE: SET THE BIT IN THE FRAME
+        case VALIDONE:
+            if(decoder->invalid == 0 && position >= 0 && position < DCF77FRAMEBITS) {
+                decoder->frame[position >> 3] |= (unsigned char) (1 << (position & 7));
+#ifdef DCF77STITCH
+                decoder->valid[position >> 3] |= (unsigned char) (1 << (position & 7));
+#endif
+                if(!result) result = matchBit(decoder, position);
+            }
+            break;
+
+        // CASE VALIDSECOND: NEXT BIT
+        case VALIDSECOND:
+            if(decoder->invalid == 0) decoder->position++;
+            break;
+
+        // CASE VALIDMINUTE: DECODE A COMPLETE FRAME AND START THE NEXT ONE
+        case VALIDMINUTE:
+#if defined(DCF77STITCH)
+            result = stitchFrame(decoder, tag);
+#elif !defined(DCF77SOFT)
+            if(position == DCF77FRAMEBITS - 1 + decoder->leapMinute) result = decodeFrame(decoder);
+#endif
+            decoder->position = 0;
+            decoder->invalid = 0;
+            decoder->leapMinute = 0;
+            decoder->prediction = PREDICTNONE;          // Until the next predictDecoderDCF77()
+            break;
+
+        // CASE NODCF77EVENT:
+        case NODCF77EVENT:
+            break;
+    }
+
+    // MINUTE FIELD COMPLETE: A LEAP SECOND IS ANNOUNCED AND THE FRAME ENCODES MINUTE 00
+    if((event == VALIDZERO || event == VALIDONE) && position == 28) {
+        decoder->leapMinute = (char) (getField(decoder->frame, 19, 1) && getField(decoder->frame, 21, 7) == 0);
+    }
+    return result;
+}
+
+/* ********** FUNCTION: pushSamplesDecoderDCF77(...) **********
+ * Description:     Classify a block of equidistant samples and assemble the frames
+ * Parameter:       DCF77DECODER *decoder
+ *                  const char *samples     signal levels, 0 or 1
+ *                  int count               number of samples
+ *                  unsigned long time      time of the first sample
+ *                  unsigned long period    time between two samples
+ * Return:          Number of valid frames decoded
+ */
+int pushSamplesDecoderDCF77(DCF77DECODER *decoder, const char *samples, int count,
+                            unsigned long time, unsigned long period) {
+    int frames = 0;
+    int i;
+
+    for(i = 0; i < count; i++, time += period) {
+        if(eventDecoderDCF77(decoder, sampleDecoderDCF77(decoder, samples[i], time)) > 0) frames++;
+    }
+    return frames;
+}
+
+/* ********** FUNCTION: initFilterDecoderDCF77(...) **********
+ * Description:     Initialize a glitch filter, the signal starts high
+ * Parameter:       DCF77FILTER *filter
+ * Return:          -
+ */
+void initFilterDecoderDCF77(DCF77FILTER *filter) {
+    filter->history = 0xFF;
+    filter->level = 1;
+}
+
+/* ********** FUNCTION: filterDecoderDCF77(...) **********
+ * Description:     Deglitch an oversampled signal, e.g. sampled every 1ms. The
+ *                  output changes, when at least FILTERHIGH of the last FILTERBITS
+ *                  samples are high or at most FILTERLOW, so spikes of up to 3
+ *                  samples are suppressed. Both edges are delayed by 4 samples.
+ *                  Constant run time, can be called in interrupt context.
+ * Parameter:       DCF77FILTER *filter
+ *                  char sample             raw signal level, 0 or 1
+ * Return:          filtered signal level
+ */
+char filterDecoderDCF77(DCF77FILTER *filter, char sample) {
+    unsigned char ones;
+
+    filter->history = (unsigned char) ((filter->history << 1) | (sample & 1));
+    ones = onesTable[filter->history & ((1 << FILTERBITS) - 1)];
+    if(ones >= FILTERHIGH) {
+        filter->level = 1;
+    } else if(ones <= FILTERLOW) {
+        filter->level = 0;
+    }
+    return filter->level;
+}
+
+/* ********** FUNCTION: encodeDecoderDCF77(...) **********
+ * Description:     Build the frame for a date and time, e.g. for simulation.
+ *                  The zone bits and the announcement bits 16 and 19 are set from
+ *                  the time, all other flags are 0.
+ * Parameter:       unsigned char *frame    DCF77FRAMEBYTES bytes
+ *                  const DCF77TIME *time
+ * Return:          -
+ */
+void encodeDecoderDCF77(unsigned char *frame, const DCF77TIME *time) {
+    int i;
+
+    for(i = 0; i < DCF77FRAMEBYTES; i++) {
+        frame[i] = 0;
+    }
+    putField(frame, 16, 1, (unsigned char) time->announce);
+    putField(frame, time->summer ? 17 : 18, 1, 1);      // CEST or CET
+    putField(frame, 19, 1, (unsigned char) time->leap);
+    putField(frame, 20, 1, 1);                          // Start of the time information
+    putBCD(frame, 21, 7, (unsigned char) time->minute);
+    putBCD(frame, 29, 6, (unsigned char) time->hour);
+    putBCD(frame, 36, 6, (unsigned char) time->day);
+    putField(frame, 42, 3, (unsigned char) time->weekday);
+    putBCD(frame, 45, 5, (unsigned char) time->month);
+    putBCD(frame, 50, 8, (unsigned char) (time->year % 100));
+
+    // EVEN PARITY BITS
+    putField(frame, 28, 1, (unsigned char) checkParity(frame, 21, 27));
+    putField(frame, 35, 1, (unsigned char) checkParity(frame, 29, 34));
+    putField(frame, 58, 1, (unsigned char) checkParity(frame, 36, 57));
+}
+
+/* ********** FUNCTION: predictDecoderDCF77(...) **********
+ * Description:     Set the expected time of the frame, which is just starting,
+ *                  i.e. call after the minute marker with the time of the next minute
+ * Parameter:       DCF77DECODER *decoder
+ *                  const DCF77TIME *time
+ * Return:          -
+ */
+void predictDecoderDCF77(DCF77DECODER *decoder, const DCF77TIME *time) {
+    encodeDecoderDCF77(decoder->predicted, time);
+    decoder->matches = 0;
+    decoder->prediction = PREDICTACTIVE;
+}
+
+/* ********** FUNCTION: advanceDecoderDCF77(...) **********
+ * Description:     Advance a date and time by some minutes, including leap years.
+ *                  An announced change between CET and CEST is done at the next full
+ *                  hour, the announcements are valid until the minute after that hour.
+ * Parameter:       DCF77TIME *time
+ *                  int minutes     0..
+ * Return:          -
+ */
+void advanceDecoderDCF77(DCF77TIME *time, int minutes) {
+    static const char monthDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    int last;
+
+    for(; minutes > 0; minutes--) {
+        if(time->minute == 0) {
+            time->announce = 0;
+            time->leap = 0;
+        }
+        if(++time->minute < 60) continue;
+        time->minute = 0;
+        if(time->announce) {                            // 02:00 CET -> 03:00 CEST, 03:00 CEST -> 02:00 CET
+            time->hour = (char) (time->hour + (time->summer ? -1 : 1));
+            time->summer = (char) !time->summer;
+        }
+        if(++time->hour < 24) continue;
+        time->hour = 0;
+        time->weekday = (char) (time->weekday % 7 + 1);
+        last = monthDays[time->month - 1];
+        if(time->month == 2 && time->year % 4 == 0 && (time->year % 100 != 0 || time->year % 400 == 0)) last = 29;
+        if(++time->day <= last) continue;
+        time->day = 1;
+        if(++time->month <= 12) continue;
+        time->month = 1;
+        time->year++;
+    }
+}
+
+
+/* ********** FUNCTION: matchBit(...) **********
+ * Description:     Compare a received bit with the prediction
+ * Parameter:       DCF77DECODER *decoder
+ *                  int position        bit number
+ * Return:          2 -> prediction confirmed with this bit
+ *                  -2 -> first bit, which did not match, also after the confirmation
+ *                  0 -> otherwise
+ */
+static int matchBit(DCF77DECODER *decoder, int position) {
+    unsigned char mask = (unsigned char) (1 << (position & 7));
+
+    // ONLY THE TIME INFORMATION IS PREDICTABLE, NOT THE WEATHER AND STATUS BITS 0..19.
+    // THE BITS AFTER THE CONFIRMATION ARE STILL COMPARED FOR THE FRAME ACCEPTANCE.
+    if(decoder->prediction == PREDICTNONE || decoder->prediction == PREDICTDIVERGED || position < 20) return 0;
+
+    if((decoder->frame[position >> 3] ^ decoder->predicted[position >> 3]) & mask) {
+        decoder->prediction = PREDICTDIVERGED;
+        return -2;
+    }
+    if(++decoder->matches == decoder->matchRequired) {
+        decoder->prediction = PREDICTCONFIRMED;
+        return 2;
+    }
+    return 0;
+}
+
+/* ********** FUNCTION: validTime(...) **********
+ * Description:     Range check of a decoded time. The parity bits do not detect
+ *                  a frame, which is consistently corrupt or shifted by a lost
+ *                  second, so every decoding path checks the fields, too.
+ * Parameter:       const DCF77TIME *time
+ * Return:          1 -> all fields in range, 0 -> otherwise
+ */
+static int validTime(const DCF77TIME *time) {
+    return time->minute >= 0 && time->minute < 60 && time->hour >= 0 && time->hour < 24 &&
+           time->day >= 1 && time->day <= 31 && time->weekday >= 1 && time->weekday <= 7 &&
+           time->month >= 1 && time->month <= 12 && time->year >= 2000 && time->year <= 2099;
+}
+
+#ifndef DCF77SOFT
+/* ********** FUNCTION: sameTime(...) **********
+ * Description:     Compare two times
+ * Parameter:       const DCF77TIME *a, *b
+ * Return:          1 -> equal, 0 -> different
+ */
+static int sameTime(const DCF77TIME *a, const DCF77TIME *b) {
+    return a->minute == b->minute && a->hour == b->hour && a->day == b->day &&
+           a->weekday == b->weekday && a->month == b->month && a->year == b->year &&
+           a->summer == b->summer;
+}
+
+#ifndef DCF77STITCH
+/* ********** FUNCTION: decodeFrame(...) **********
+ * Description:     Decode the frame, check the parity bits and call the frame ready function
+ * Parameter:       DCF77DECODER *decoder
+ * Return:          1 -> VALID PARITY
+ *                  -1 -> INVALID PARITY, ZONE BITS OR TIME OUT OF RANGE
+ */
+static int decodeFrame(DCF77DECODER *decoder) {
+    const unsigned char *frame = decoder->frame;
+    DCF77TIME time;
+
+    // CHECK PARITY
+    if(checkParity(frame, 21, 27) || checkParity(frame, 29, 34) || checkParity(frame, 36, 57)) {
+        return -1;
+    }
+
+    // EXACTLY ONE OF THE ZONE BITS 17 (CEST) AND 18 (CET)
+    if(getField(frame, 17, 1) == getField(frame, 18, 1)) {
+        return -1;
+    }
+
+    // READ BCD FIELDS: MINUTES 7 BITS, HOURS 6 BITS, DAYS 6 BITS, WEEKDAY 3 BITS, MONTHS 5 BITS, YEARS 8 BITS
+    zoneTime(decoder, &time);
+    time.minute = (char) getBCD(frame, 21, 7);
+    time.hour = (char) getBCD(frame, 29, 6);
+    time.day = (char) getBCD(frame, 36, 6);
+    time.weekday = (char) getField(frame, 42, 3);
+    time.month = (char) getBCD(frame, 45, 5);
+    time.year = getBCD(frame, 50, 8) + 2000;
+    if(!validTime(&time)) {
+        return -1;
+    }
+
+    return acceptTime(decoder, &time);
+}
+#endif
+
+/* ********** FUNCTION: acceptTime(...) **********
+ * Description:     Accept a decoded time and call the frame ready function
+ * Parameter:       DCF77DECODER *decoder
+ *                  const DCF77TIME *time
+ * Return:          1 -> time accepted
+ *                  -1 -> frame diverged from the prediction and does not follow the last one
+ */
+static int acceptTime(DCF77DECODER *decoder, const DCF77TIME *time) {
+    // FRAME DIVERGED FROM THE PREDICTION: ACCEPT IT ONLY, IF IT FOLLOWS THE LAST ONE
+    if(decoder->prediction == PREDICTDIVERGED) {
+        if(decoder->pendingValid) advanceDecoderDCF77(&decoder->pending, 1);
+        if(!decoder->pendingValid || !sameTime(&decoder->pending, time)) {
+            decoder->pending = *time;
+            decoder->pendingValid = 1;
+            return -1;
+        }
+    }
+    decoder->pendingValid = 0;
+
+    if(decoder->frameReady) decoder->frameReady(decoder, time);
+    return 1;
+}
+#endif
+
+/* ********** FUNCTION: checkParity(...) **********
+ * Description: Function to check for even parity of the bits startIndex..endIndex
+ *              and the parity bit endIndex+1. The masked frame bytes are combined
+ *              with XOR, so a single table lookup gives the parity.
+ * Parameters:  const unsigned char *frame, int startIndex, int endindex
+ * Returns:     0 -> VALID PARITY
+ *              1 -> INVALID PARITY
+ */
+static int checkParity(const unsigned char *frame, int startIndex, int endIndex) {
+    int first = startIndex >> 3;
+    int last = (endIndex + 1) >> 3;
+    unsigned char sum = 0;
+    int i;
+
+    // XOR ALL BYTES, MASK THE BITS OUTSIDE OF THE RANGE IN THE FIRST AND LAST BYTE
+    for(i = first; i <= last; i++) {
+        sum ^= frame[i];
+    }
+    sum ^= frame[first] & (unsigned char) ((1 << (startIndex & 7)) - 1);
+    sum ^= frame[last] & (unsigned char) (0xFE << ((endIndex + 1) & 7));
+
+    return parityTable[sum];
+}
+
+/* ********** FUNCTION: getField(...) **********
+ * Description: Extract a field of the frame, bit start is the least significant bit
+ * Parameters:  const unsigned char *frame
+ *              int start       first bit of the field
+ *              int length      number of bits, 1..8
+ * Returns:     value of the field
+ */
+static unsigned char getField(const unsigned char *frame, int start, int length) {
+    unsigned int word = frame[start >> 3] | (frame[(start >> 3) + 1] << 8);
+
+    return (unsigned char) ((word >> (start & 7)) & ((1 << length) - 1));
+}
+
+/* ********** FUNCTION: getBCD(...) **********
+ * Description: Extract a BCD coded field of the frame
+ * Parameters:  const unsigned char *frame
+ *              int start       first bit of the field, i.e. the least significant bit of the ones
+ *              int length      number of bits, 5..8
+ * Returns:     binary value of the field
+ */
+static unsigned char getBCD(const unsigned char *frame, int start, int length) {
+    unsigned char bcd = getField(frame, start, length);
+
+    return (unsigned char) ((bcd & 0x0F) + bcdTens[bcd >> 4]);
+}
+
+/* ********** FUNCTION: zoneTime(...) **********
+ * Description: Zone and announcement bits of the current frame. The zone is given by
+ *              the bits 17 (CEST) and 18 (CET). If both or none are set, e.g. a bit
+ *              was lost, the last valid zone is kept.
+ * Parameters:  DCF77DECODER *decoder
+ *              DCF77TIME *time     summer, announce and leap are set
+ * Returns:     -
+ */
+static void zoneTime(DCF77DECODER *decoder, DCF77TIME *time) {
+    unsigned char bits = getField(decoder->frame, 16, 4);
+
+    if((bits & 6) == 2 || (bits & 6) == 4) {
+        decoder->summer = (char) ((bits & 6) == 2);
+    }
+    time->summer = decoder->summer;
+    time->announce = (char) (bits & 1);
+    time->leap = (char) ((bits >> 3) & 1);
+}
+
+/* ********** FUNCTION: putField(...) **********
+ * Description: Store a field in the frame, bit start is the least significant bit
+ * Parameters:  unsigned char *frame
+ *              int start       first bit of the field
+ *              int length      number of bits, 1..8
+ *              unsigned char value
+ * Returns:     -
+ */
+static void putField(unsigned char *frame, int start, int length, unsigned char value) {
+    int i;
+
+    for(i = start; i < start + length; i++, value >>= 1) {
+        if(value & 1) frame[i >> 3] |= (unsigned char) (1 << (i & 7));
+        else          frame[i >> 3] &= (unsigned char) ~(1 << (i & 7));
+    }
+}
+
+/* ********** FUNCTION: putBCD(...) **********
+ * Description: Store a value 0..99 BCD coded in the frame
+ * Parameters:  unsigned char *frame
+ *              int start       first bit of the field
+ *              int length      number of bits, 5..8
+ *              unsigned char value
+ * Returns:     -
+ */
+static void putBCD(unsigned char *frame, int start, int length, unsigned char value) {
+    putField(frame, start, length, (unsigned char) (((value / 10) << 4) | (value % 10)));
+}
+
+
+#ifdef DCF77SOFT
+/* ********** FUNCTION: softRestart(...) **********
+ * Description: Clear the confidence sums and minute scores, task context
+ * Parameters:  DCF77DECODER *decoder
+ * Returns:     -
+ */
+static void softRestart(DCF77DECODER *decoder) {
+    int i;
+
+    for(i = 0; i < DCF77FRAMEBITS - 29; i++) {
+        decoder->accumulator[i] = 0;
+    }
+    for(i = 0; i < 60; i++) {
+        decoder->minuteScore[i] = 0;
+    }
+    decoder->rotation = 0;
+}
+
+/* ********** FUNCTION: softMinute(...) **********
+ * Description: Start a new minute at the anchor time, classification context.
+ *              The soft bits of the completed minute are left for softDecode().
+ * Parameters:  DCF77DECODER *decoder
+ * Returns:     -
+ */
+static void softMinute(DCF77DECODER *decoder) {
+    signed char *soft;
+    int i;
+
+    decoder->bank ^= 1;
+    soft = decoder->soft[(int) decoder->bank];
+    for(i = 0; i < DCF77FRAMEBITS; i++) {
+        soft[i] = SOFTNONE;
+    }
+}
+
+/* ********** FUNCTION: softFlywheel(...) **********
+ * Description: Complete the minute, if the minute marker is overdue by more than
+ *              the tolerance of a second, classification context
+ * Parameters:  DCF77DECODER *decoder
+ *              unsigned long time
+ * Returns:     -
+ */
+static void softFlywheel(DCF77DECODER *decoder, unsigned long time) {
+    unsigned long minute = (60 + decoder->leapMinute) * decoder->unitsPerSecond;
+
+    if(decoder->anchored && time - decoder->anchor >= minute + decoder->secondMax - decoder->unitsPerSecond) {
+        if(time - decoder->anchor >= 2 * minute) {      // Long signal loss, start again
+            decoder->anchored = 0;
+            decoder->lost = 1;
+            return;
+        }
+        decoder->anchor += minute;
+        decoder->leapMinute = 0;
+        decoder->softFrames++;
+        softMinute(decoder);
+    }
+}
+
+/* ********** FUNCTION: softEdge(...) **********
+ * Description: Update the anchor at a minute marker and the confidence of the
+ *              seconds covered by a low pulse, classification context
+ * Parameters:  DCF77DECODER *decoder
+ *              char signal             signal level after the edge
+ *              unsigned long time      time of the edge
+ *              DCF77EVENT event        result of the classification
+ * Returns:     -
+ */
+static void softEdge(DCF77DECODER *decoder, char signal, unsigned long time, DCF77EVENT event) {
+    unsigned long ups = decoder->unitsPerSecond;
+    unsigned long window = ups / 10;                    // 100ms
+    unsigned long start, end, offset, overlap, low, high;
+    signed char *soft;
+    long value;
+    int k;
+
+    // MINUTE MARKER: ANCHOR THE SECONDS
+    if(event == VALIDMINUTE) {
+        offset = time - decoder->anchor - (60 + decoder->leapMinute) * ups; // Distance to the expected marker
+        decoder->leapMinute = 0;
+        if(decoder->anchored && offset + window > 2 * window) {
+            decoder->lost = 1;                          // Marker at an unexpected time
+        }
+        if(decoder->anchored && !decoder->lost) {
+            decoder->softFrames++;
+        }
+        decoder->anchor = time;
+        decoder->anchored = 1;
+        softMinute(decoder);
+    }
+    if(!signal) {
+        decoder->lowStart = time;
+    }
+    if(!decoder->anchored) return;
+
+    soft = decoder->soft[(int) decoder->bank];
+    end = time - decoder->anchor;
+    if(end >= DCF77FRAMEBITS * ups) return;             // Second 59 has no bit
+
+    // ~FALLING EDGE: A SECOND STARTS, IF THE EDGE IS CLOSE TO THE EXPECTED TIME
+    if(!signal) {
+        k = (int) (end / ups);
+        offset = end - k * ups;
+        if(offset >= ups - window / 2) k++;
+        else if(offset >= window) return;
+        if(k < DCF77FRAMEBITS && soft[k] == SOFTNONE) soft[k] = -100;
+        return;
+    }
+
+    // ~RISING EDGE: ADD THE LOW TIME IN THE 100..200MS WINDOWS
+    start = decoder->lowStart - decoder->anchor;
+    if(start > end) start = 0;                          // Low pulse started before the anchor
+    for(k = (int) (start / ups); k <= (int) (end / ups); k++) {
+        low = k * ups + window;
+        high = low + window;
+        if(end <= low || start >= high || soft[k] == SOFTNONE) continue;
+        overlap = (end < high ? end : high) - (start > low ? start : low);
+        value = soft[k] + (long) (overlap * 200 / window);
+        soft[k] = (signed char) (value > 100 ? 100 : value);
+    }
+}
+
+/* ********** FUNCTION: softDecode(...) **********
+ * Description: Accumulate the soft bits of the completed minute and decode the
+ *              time, if the confidence is high enough, task context
+ * Parameters:  DCF77DECODER *decoder
+ * Returns:     1 -> time accepted, the frame ready function was called
+ *              0 -> otherwise
+ */
+static int softDecode(DCF77DECODER *decoder) {
+    const signed char *soft = decoder->soft[decoder->bank ^ 1];
+    unsigned char *frame = decoder->frame;
+    int threshold = decoder->softThreshold;
+    int best = 0, second = 0;
+    int c, i, k, s, score;
+    unsigned char code;
+    DCF77TIME time;
+
+    // MINUTE SCORES: score OF VALUE c IS KEPT IN minuteScore[(c - rotation) MOD 60]
+    decoder->rotation = (char) ((decoder->rotation + 1) % 60);
+    for(c = 0; c < 60; c++) {
+        code = (unsigned char) (((c / 10) << 4) | (c % 10));
+        code |= (unsigned char) (parityTable[code] << 7);
+        score = 0;
+        for(k = 0; k < 8; k++) {
+            s = soft[21 + k] == SOFTNONE ? 0 : soft[21 + k];
+            score += (code >> k) & 1 ? s : -s;
+        }
+        i = (c + 60 - decoder->rotation) % 60;
+        decoder->minuteScore[i] += score;
+    }
+    for(c = 0; c < 60; c++) {
+        i = (c + 60 - decoder->rotation) % 60;
+        if(decoder->minuteScore[i] > decoder->minuteScore[(best + 60 - decoder->rotation) % 60]) best = c;
+    }
+    second = best ? 0 : 1;
+    for(c = 0; c < 60; c++) {
+        i = (c + 60 - decoder->rotation) % 60;
+        if(c != best && decoder->minuteScore[i] > decoder->minuteScore[(second + 60 - decoder->rotation) % 60]) second = c;
+    }
+    best = (best + 60 - decoder->rotation) % 60;        // Index of the best and the second best value
+    second = (second + 60 - decoder->rotation) % 60;
+    if(decoder->minuteScore[best] > 8 * SOFTMAX) {      // Keep the scores in range
+        for(i = 0; i < 60; i++) decoder->minuteScore[i] /= 2;
+    }
+
+    // HOUR AND DATE: A NEW HOUR RESTARTS THE SUMS
+    c = (best + decoder->rotation) % 60;
+    for(k = 29; k < DCF77FRAMEBITS; k++) {
+        s = soft[k] == SOFTNONE ? 0 : soft[k];
+        if(c == 0) decoder->accumulator[k - 29] = 0;
+        s += decoder->accumulator[k - 29];
+        decoder->accumulator[k - 29] = s > SOFTMAX ? SOFTMAX : (s < -SOFTMAX ? -SOFTMAX : s);
+    }
+
+    // CONFIDENCE CHECK
+    if(decoder->minuteScore[best] - decoder->minuteScore[second] < 2 * threshold) return 0;
+    for(k = 29; k < DCF77FRAMEBITS; k++) {
+        s = decoder->accumulator[k - 29];
+        if(s < threshold && s > -threshold) return 0;
+    }
+
+    // BUILD THE FRAME FROM THE DECISIONS, CHECK PARITY AND RANGES
+    putBCD(frame, 21, 7, (unsigned char) c);
+    putField(frame, 28, 1, parityTable[getField(frame, 21, 7)]);
+    for(k = 29; k < DCF77FRAMEBITS; k++) {
+        putField(frame, k, 1, (unsigned char) (decoder->accumulator[k - 29] > 0));
+    }
+
+    // ZONE AND ANNOUNCEMENT BITS 16..19 OF THE COMPLETED MINUTE. THE HARD FRAME MAY HOLD THE
+    // BITS OF AN OLDER MINUTE AFTER AN INVALID EVENT. UNKNOWN ZONE BITS KEEP THE LAST ZONE
+    for(k = 16; k < 20; k++) {
+        putField(frame, k, 1, (unsigned char) (soft[k] != SOFTNONE && soft[k] > 0));
+    }
+    if(checkParity(frame, 29, 34) || checkParity(frame, 36, 57)) return 0;
+    zoneTime(decoder, &time);
+    time.minute = (char) c;
+    time.hour = (char) getBCD(frame, 29, 6);
+    time.day = (char) getBCD(frame, 36, 6);
+    time.weekday = (char) getField(frame, 42, 3);
+    time.month = (char) getBCD(frame, 45, 5);
+    time.year = getBCD(frame, 50, 8) + 2000;
+    if(!validTime(&time)) return 0;
+
+    if(decoder->frameReady) decoder->frameReady(decoder, &time);
+    return 1;
+}
+#endif
+
+#ifdef DCF77ADAPTIVE
+/* ********** FUNCTION: adaptRestart(...) **********
+ * Description: Start the clustering again at the nominal widths of 100 and 200ms
+ * Parameters:  DCF77DECODER *decoder
+ * Returns:     -
+ */
+static void adaptRestart(DCF77DECODER *decoder) {
+    decoder->zeroSum = 8 * decoder->gapNominal;
+    decoder->oneSum = 16 * decoder->gapNominal;
+    decoder->windowMin = decoder->pulseMax;
+    decoder->windowMax = 0;
+    decoder->windowCount = 0;
+    decoder->zeroHits = 0;
+    decoder->oneHits = 0;
+    decoder->zeroCount = 0;
+    decoder->oneCount = 0;
+    decoder->secondStart = 0;
+}
+
+/* ********** FUNCTION: adaptUpdate(...) **********
+ * Description: Update the running mean of one side with a low pulse, classification context
+ * Parameters:  DCF77DECODER *decoder
+ *              unsigned long width     width of the low pulse
+ *              char side               1 -> above the middle of the means
+ * Returns:     1 -> means too close, clustering started again
+ *              0 -> otherwise
+ */
+static int adaptUpdate(DCF77DECODER *decoder, unsigned long width, char side) {
+    // UPDATE THE MEAN OF THE SIDE BY 1/8 OF THE DIFFERENCE
+    if(side) {
+        decoder->oneSum += width - (decoder->oneSum >> 3);
+        decoder->oneHits++;
+        if(decoder->oneCount < DCF77ADAPTLOCK) decoder->oneCount++;
+    } else {
+        decoder->zeroSum += width - (decoder->zeroSum >> 3);
+        decoder->zeroHits++;
+        if(decoder->zeroCount < DCF77ADAPTLOCK) decoder->zeroCount++;
+    }
+
+    // A CLUSTER WITH ALMOST NO PULSES IN THE WINDOW: START AGAIN AT THE EXTREMES OF THE WINDOW
+    if(width < decoder->windowMin) decoder->windowMin = width;
+    if(width > decoder->windowMax) decoder->windowMax = width;
+    if(++decoder->windowCount == ADAPTWINDOW) {
+        if((decoder->zeroHits < ADAPTWINDOW / 8 || decoder->oneHits < ADAPTWINDOW / 8) &&
+           decoder->windowMax >= decoder->windowMin + decoder->gapMin) {
+            decoder->zeroSum = 8 * decoder->windowMin;
+            decoder->oneSum = 8 * decoder->windowMax;
+        }
+        decoder->windowMin = decoder->pulseMax;
+        decoder->windowMax = 0;
+        decoder->windowCount = 0;
+        decoder->zeroHits = 0;
+        decoder->oneHits = 0;
+    }
+
+    // MEANS TOO CLOSE: FIXED WINDOWS AGAIN
+    if((decoder->oneSum >> 3) < (decoder->zeroSum >> 3) + decoder->gapMin) {
+        adaptRestart(decoder);
+        return 1;
+    }
+    return 0;
+}
+
+/* ********** FUNCTION: adaptPulse(...) **********
+ * Description: Classify a low pulse with the running means and update them with
+ *              pulses, which start a valid second, classification context
+ * Parameters:  DCF77DECODER *decoder
+ *              unsigned long width     width of the low pulse
+ *              DCF77EVENT event        result of the fixed windows
+ * Returns:     VALIDZERO, VALIDONE or INVALID
+ */
+static DCF77EVENT adaptPulse(DCF77DECODER *decoder, unsigned long width, DCF77EVENT event) {
+    unsigned long zero = decoder->zeroSum >> 3;
+    unsigned long one = decoder->oneSum >> 3;
+    unsigned long gap = one - zero;
+    unsigned long middle = zero + gap / 2;
+    char side = (char) (width >= middle);
+
+    if(width < decoder->pulseMin || width > decoder->pulseMax) return INVALID;
+    if(decoder->secondStart && adaptUpdate(decoder, width, side)) return event;
+    if(decoder->zeroCount < DCF77ADAPTLOCK || decoder->oneCount < DCF77ADAPTLOCK) return event;
+
+    // CLASSIFY WITH THE MEANS BEFORE THE UPDATE: DEAD BAND AROUND THE MIDDLE, RANGE BEYOND THE MEANS
+    if(width + gap / 8 > middle && width < middle + gap / 8) return INVALID;
+    if(width + gap / 2 < zero || width > one + gap / 2) return INVALID;
+    return side ? VALIDONE : VALIDZERO;
+}
+#endif
+
+#ifdef DCF77STITCH
+// Hour and date bits 29..58 and time information bits 21..58 in the frame bytes
+static const unsigned char stitchMask[DCF77FRAMEBYTES] = { 0x00, 0x00, 0x00, 0xE0, 0xFF, 0xFF, 0xFF, 0x07 };
+static const unsigned char timeMask[DCF77FRAMEBYTES]   = { 0x00, 0x00, 0xE0, 0xFF, 0xFF, 0xFF, 0xFF, 0x07 };
+
+/* ********** FUNCTION: stitchEdge(...) **********
+ * Description: Derive the second of a falling edge from the anchor, bridge missed
+ *              minute markers and detect additional edges, classification context
+ * Parameters:  DCF77DECODER *decoder
+ *              unsigned long time      time of the falling edge
+ *              DCF77EVENT event        result of the classification
+ * Returns:     VALIDMINUTE -> one or more minutes completed
+ *              INVALID -> additional edge, the bit of decoder->spoiled is discarded
+ *              event -> otherwise
+ */
+static DCF77EVENT stitchEdge(DCF77DECODER *decoder, unsigned long time, DCF77EVENT event) {
+    unsigned long ups = decoder->unitsPerSecond;
+    unsigned long window = ups / 10;                    // 100ms
+    unsigned long end, k;
+    signed char last = decoder->second;
+
+    decoder->second = -1;
+    if(decoder->anchored) {
+        // LEAP SECOND: THE SECONDS AFTER SECOND 60 START ONE SECOND LATER
+        if(decoder->leapMinute && time - decoder->anchor >= 61 * ups - window) {
+            decoder->anchor += ups;
+        }
+        end = time - decoder->anchor + window;
+        k = end / ups;
+        if(k >= 60 * 60) {                              // Long signal loss, start again
+            decoder->anchored = 0;
+
+        // ~EDGE CLOSE TO THE EXPECTED START OF SECOND k
+        } else if(end - k * ups < 2 * window) {
+            if(k < 60 && event != VALIDMINUTE) {
+                if((signed char) k != last) {
+                    decoder->second = (signed char) k;
+                    return event;
+                }
+                decoder->spoiled = (signed char) k;     // Second edge in the same second
+                return INVALID;
+            }
+            // ONE OR MORE MINUTES COMPLETED, THE MINUTE MARKER MAY BE MISSING
+            if(k >= 60 && (k % 60 == 0 || event != VALIDMINUTE)) {
+                decoder->anchor += k / 60 * 60 * ups;
+                if(event == VALIDMINUTE) decoder->anchor = time;    // Follow the transmitter
+                decoder->elapsed = (char) (k / 60);
+                decoder->second = (signed char) (k % 60);
+                return VALIDMINUTE;
+            }
+
+        // ~EDGE BETWEEN THE SECONDS: DISCARD THE BIT OF THE CURRENT SECOND
+        } else if(event != VALIDMINUTE) {
+            k = (end - window) / ups;
+            decoder->spoiled = (signed char) (k < DCF77FRAMEBITS ? (int) k : -1);
+            return INVALID;
+        }
+    }
+
+    // FIRST MINUTE MARKER OR MARKER AT AN UNEXPECTED TIME: ANCHOR THE SECONDS
+    if(event == VALIDMINUTE) {
+        decoder->anchor = time;
+        decoder->anchored = 1;
+        decoder->elapsed = 0;
+        decoder->second = 0;
+    }
+    return event;
+}
+
+/* ********** FUNCTION: stitchRestart(...) **********
+ * Description: Drop the stitched bits and the minute field, task context
+ * Parameters:  DCF77DECODER *decoder
+ * Returns:     -
+ */
+static void stitchRestart(DCF77DECODER *decoder) {
+    int i;
+
+    for(i = 0; i < DCF77FRAMEBYTES; i++) {
+        decoder->stitchValid[i] = 0;
+    }
+    decoder->minuteValid = 0;
+}
+
+/* ********** FUNCTION: stitchFrame(...) **********
+ * Description: Merge the completed frame into the stitched frame and decode the time,
+ *              if all fields are known, task context
+ * Parameters:  DCF77DECODER *decoder
+ *              int elapsed             minutes completed at the marker, 0 -> new anchor,
+ *                                      see stitchEdge()
+ * Returns:     1 -> time accepted, the frame ready function was called
+ *              -1 -> stitched frame with invalid parity or range or time not accepted
+ *              0 -> otherwise
+ */
+static int stitchFrame(DCF77DECODER *decoder, int elapsed) {
+    unsigned char *frame = decoder->frame;
+    unsigned char *valid = decoder->valid;
+    unsigned int encoded = decoder->minutes + 1;        // Minute encoded in the completed frame
+    int conflict = 0, empty = 1, complete = 1;
+    unsigned char mask;
+    int i, minute = 0, result = 0;
+    DCF77TIME time;
+
+    decoder->minutes += elapsed;
+    if(elapsed == 0) {                                  // New anchor, bits belong to the old one
+        stitchRestart(decoder);
+        for(i = 0; i < DCF77FRAMEBYTES; i++) {
+            valid[i] = 0;
+        }
+        return 0;
+    }
+
+    // MINUTE FIELD 21..28 COMPLETE WITH VALID PARITY
+    if((valid[2] & 0xE0) == 0xE0 && (valid[3] & 0x1F) == 0x1F && !checkParity(frame, 21, 27) &&
+       getBCD(frame, 21, 7) < 60) {
+        decoder->stitchMinute = (char) getBCD(frame, 21, 7);
+        decoder->minuteIndex = encoded;
+        decoder->minuteValid = 1;
+    }
+
+    // DROP THE STITCHED BITS OF A PREVIOUS HOUR AND THE ONES, WHICH DIFFER FROM THE NEW BITS
+    for(i = 0; i < DCF77FRAMEBYTES; i++) {
+        if(decoder->stitchValid[i]) empty = 0;
+        if((frame[i] ^ decoder->stitch[i]) & valid[i] & decoder->stitchValid[i] & stitchMask[i]) conflict = 1;
+    }
+    if(decoder->minuteValid) {
+        minute = (int) ((decoder->stitchMinute + encoded - decoder->minuteIndex) % 60);
+        if(encoded - decoder->stitchIndex > (unsigned int) minute) conflict = 1;
+    }
+    if(conflict || empty) {
+        for(i = 0; i < DCF77FRAMEBYTES; i++) {
+            decoder->stitchValid[i] = 0;
+        }
+        decoder->stitchIndex = encoded;
+    }
+
+    // MERGE THE HOUR AND DATE BITS
+    for(i = 0; i < DCF77FRAMEBYTES; i++) {
+        mask = valid[i] & stitchMask[i];
+        decoder->stitch[i] = (unsigned char) ((decoder->stitch[i] & ~mask) | (frame[i] & mask));
+        decoder->stitchValid[i] |= mask;
+        if(decoder->stitchValid[i] != stitchMask[i]) complete = 0;
+        valid[i] = 0;
+    }
+
+    // DECODE, IF ALL FIELDS ARE KNOWN
+    if(decoder->minuteValid && complete) {
+        frame = decoder->stitch;
+        if(checkParity(frame, 29, 34) || checkParity(frame, 36, 57)) {
+            stitchRestart(decoder);
+            return -1;
+        }
+        zoneTime(decoder, &time);                       // Zone bits of the current frame, not stitched
+        time.minute = (char) minute;
+        time.hour = (char) getBCD(frame, 29, 6);
+        time.day = (char) getBCD(frame, 36, 6);
+        time.weekday = (char) getField(frame, 42, 3);
+        time.month = (char) getBCD(frame, 45, 5);
+        time.year = getBCD(frame, 50, 8) + 2000;
+        if(!validTime(&time)) {
+            stitchRestart(decoder);
+            return -1;
+        }
+
+        // BITS FROM PREVIOUS FRAMES MAY DIFFER FROM THE PREDICTION, TOO
+        if(decoder->prediction == PREDICTACTIVE || decoder->prediction == PREDICTCONFIRMED) {
+            encodeDecoderDCF77(decoder->frame, &time);
+            for(i = 0; i < DCF77FRAMEBYTES; i++) {
+                if((decoder->frame[i] ^ decoder->predicted[i]) & timeMask[i]) decoder->prediction = PREDICTDIVERGED;
+            }
+        }
+        advanceDecoderDCF77(&time, elapsed - 1);        // Minutes without marker
+
+        // A REJECTED TIME MUST BE CONFIRMED BY NEW BITS, NOT BY THE SAME STITCHED ONES
+        if(decoder->pendingValid) advanceDecoderDCF77(&decoder->pending, decoder->minutes - decoder->pendingIndex - 1);
+        decoder->pendingIndex = decoder->minutes;
+        result = acceptTime(decoder, &time);
+        if(result < 0) stitchRestart(decoder);
+    }
+    return result;
+}
+#endif
@@ -0,0 +1,135 @@
+/*  Header for the DCF77 decoder
+
+    Computerarchitektur / Computer Architecture
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
+    Hochschule Esslingen
+*/
+
+#ifndef DCF77DECODER_H
+#define DCF77DECODER_H
+
+#define DCF77FRAMEBITS  59                      // Bits of a DCF77 minute frame
+#define DCF77FRAMEBYTES 8                       // Bytes of the bit-packed frame
+#ifndef DCF77MATCHBITS
+#define DCF77MATCHBITS  9                       // Default matching bits to confirm a prediction, see matchRequired
+#endif
+#ifndef DCF77ADAPTLOCK
+#define DCF77ADAPTLOCK  8                       // Pulses of each value before the adaptive classification is used
+#endif
+#ifdef DCF77SOFT
+#undef DCF77STITCH                              // Soft decoding replaces the frame assembly
+#endif
+#ifndef DCF77SOFTTHRESHOLD
+#define DCF77SOFTTHRESHOLD 100                  // Default confidence threshold, see softThreshold
+#endif
+
+// Data type for DCF77 signal events
+typedef enum { NODCF77EVENT=0, VALIDZERO, VALIDONE, VALIDSECOND, VALIDMINUTE, INVALID } DCF77EVENT;
+
+// Tag of an INVALID event for events lost before it, see taggedEventDecoderDCF77()
+#define DCF77TAGLOST        (-2)
+
+// States of the predicted frame matching, see predictDecoderDCF77()
+#define PREDICTNONE         0                   // No prediction for the current frame
+#define PREDICTACTIVE       1                   // All bits received so far match
+#define PREDICTCONFIRMED    2                   // matchRequired bits matched
+#define PREDICTDIVERGED     3                   // A bit did not match
+
+// Data type for the glitch filter of an oversampled signal, see filterDecoderDCF77()
+typedef struct
+{   unsigned char history;                      // Shift register of the raw samples, bit 0 is the newest
+    char level;                                 // Filtered signal level
+} DCF77FILTER;
+
+// Data type for the date and time of a DCF77 frame
+typedef struct
+{   char minute, hour, day, weekday, month;
+    int year;
+    char summer;                                // 1 -> CEST (bit 17), 0 -> CET (bit 18)
+    char announce;                              // Bit 16: CEST/CET change at the end of the hour
+    char leap;                                  // Bit 19: leap second at the end of the hour
+} DCF77TIME;
+
+// Data type for the decoder state, one variable per decoded signal.
+// Times are in decoder time units, see initDecoderDCF77()
+typedef struct DCF77DECODER
+{   unsigned long zeroMin, zeroMax;             // Low pulse width of a 0 bit
+    unsigned long oneMin, oneMax;               // Low pulse width of a 1 bit
+    unsigned long secondMin, secondMax;         // Distance of falling edges within a minute
+    unsigned long minuteMin, minuteMax;         // Distance of falling edges at the minute marker
+    unsigned long lastFalling;                  // Time of the last falling edge
+#ifdef DCF77ADAPTIVE
+    // Adaptive pulse width classification, for details see dcf77Decoder.c
+    unsigned long zeroSum, oneSum;              // 8 times the running mean width of 0 and 1 pulses
+    unsigned long pulseMin, pulseMax;           // Plausible low pulse width
+    unsigned long gapMin, gapNominal;           // Minimum and nominal distance of the means
+    unsigned long windowMin, windowMax;         // Shortest and longest pulse of the current window
+    char windowCount, zeroHits, oneHits;        // Pulses of the current window, pulses of each cluster
+    char zeroCount, oneCount;                   // Pulses of each cluster, up to DCF77ADAPTLOCK
+    char secondStart;                           // Last falling edge was a valid second or minute
+#endif
+    char lastSignal;                            // Signal level of the last sample or edge
+    unsigned char frame[DCF77FRAMEBYTES];       // Bit-packed frame, bit i in frame[i/8], bit position i%8
+    int position;                               // Position of the next bit in the frame
+    char invalid;                               // Set by an invalid event until the next minute marker
+    unsigned char predicted[DCF77FRAMEBYTES];   // Expected frame, see predictDecoderDCF77()
+    char prediction;                            // PREDICTNONE, ...
+    int matches;                                // Matching bits of the current frame
+    int matchRequired;                          // Matching bits to confirm the prediction
+    DCF77TIME pending;                          // Last frame, which diverged from the prediction
+    char pendingValid;
+    char summer;                                // Last valid zone bits 17/18, 1 -> CEST
+    char leapMinute;                            // Current minute has a leap second, see eventDecoderDCF77()
+#if defined(DCF77SOFT) || defined(DCF77STITCH)
+    unsigned long unitsPerSecond;
+    unsigned long anchor;                       // Time of the last minute marker, start of second 0
+    char anchored;                              // Anchor is valid
+#endif
+#ifdef DCF77STITCH
+    // Partial frame stitching, for details see dcf77Decoder.c
+    signed char second;                         // Second of the last falling edge, -1 off the grid
+    signed char spoiled;                        // Second with an additional edge, -1 if none
+    char elapsed;                               // Minutes completed at the last marker, 0 -> new anchor
+                                                // (classification state, see tagDecoderDCF77())
+    unsigned char valid[DCF77FRAMEBYTES];       // Bits of the current frame received
+    unsigned char stitch[DCF77FRAMEBYTES];      // Hour and date bits merged from several frames
+    unsigned char stitchValid[DCF77FRAMEBYTES]; // Bits of stitch[] received
+    unsigned int minutes;                       // Minute counter, task context
+    unsigned int stitchIndex;                   // Minute of the oldest bit in stitch[]
+    unsigned int minuteIndex;                   // Minute of the last valid minute field
+    unsigned int pendingIndex;                  // Minute of the last decoded time
+    char stitchMinute;                          // Value of the last valid minute field
+    char minuteValid;
+#endif
+#ifdef DCF77SOFT
+    // Soft decision decoding, for details see dcf77Decoder.c
+    unsigned long lowStart;                     // Time of the last falling edge
+    char lost;                                  // Set in ISR context: restart the accumulation
+    char bank;                                  // Soft bits of the current minute are in soft[bank]
+    unsigned char softFrames, softDone;         // Minutes completed, minutes accumulated
+    signed char soft[2][DCF77FRAMEBITS];        // Per bit confidence, -100 (0) .. +100 (1)
+    int accumulator[DCF77FRAMEBITS - 29];       // Confidence sums of bits 29..58, hour and date
+    int minuteScore[60];                        // Score of each minute value, rotated by rotation
+    char rotation;
+    int softThreshold;                          // Minimum confidence sum to accept a bit
+#endif
+    void (*frameReady)(struct DCF77DECODER *decoder, const DCF77TIME *time);
+} DCF77DECODER;
+
+// Public functions, for details see dcf77Decoder.c
+void initDecoderDCF77(DCF77DECODER *decoder, unsigned long unitsPerSecond,
+                      void (*frameReady)(DCF77DECODER *decoder, const DCF77TIME *time));
+DCF77EVENT sampleDecoderDCF77(DCF77DECODER *decoder, char signal, unsigned long time);
+DCF77EVENT edgeDecoderDCF77(DCF77DECODER *decoder, char signal, unsigned long time);
+int eventDecoderDCF77(DCF77DECODER *decoder, DCF77EVENT event);
+signed char tagDecoderDCF77(DCF77DECODER *decoder, DCF77EVENT event);
+int taggedEventDecoderDCF77(DCF77DECODER *decoder, DCF77EVENT event, signed char tag);
+int pushSamplesDecoderDCF77(DCF77DECODER *decoder, const char *samples, int count,
+                            unsigned long time, unsigned long period);
+void initFilterDecoderDCF77(DCF77FILTER *filter);
+char filterDecoderDCF77(DCF77FILTER *filter, char sample);
+void encodeDecoderDCF77(unsigned char *frame, const DCF77TIME *time);
+void predictDecoderDCF77(DCF77DECODER *decoder, const DCF77TIME *time);
+void advanceDecoderDCF77(DCF77TIME *time, int minutes);
+
+#endif
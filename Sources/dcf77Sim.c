@@ -10,64 +10,76 @@
     Function readPortSim() must be called periodically once every 10ms. The function returns
     the value of the (simulated) DCF77 impulse signal. The simulation provides a time range
     of 8 minutes, then the signals repeat.
+    For oversampling, readPortSim1ms() is called once every 1ms instead.
+    In the host build, the signal follows the true time, also if the local crystal is off
+    by halDrift, see halHost.c and simStep().
+
+    Host build only: simScenario selects a changeover scenario instead of the data sets,
+    see scenarioSignal(). Every second, the clock is compared with the simulated time.
 */
 
-#include <mc9s12dp256.h>                 // CPU specific defines
+#include "hal.h"                         // CPU specific defines
 #include <stdlib.h>
+#ifdef HOST
+#include <stdio.h>
+#include "halHost.h"
+#include "dcf77Decoder.h"
+#include "clock.h"
+#endif
 
 
 
 // DCF77 simulation data sets
 long dcf77Data0[16] =                    // Button on PTH.7 pressed
 {  
-//*** 2020-12-31   23:58  weekday=4 Do
-    0x7B120000, 0x0482531C,
-    0x6B320000, 0x0482531C,
-    0x00120000, 0x00843410,
-    0x10320000, 0x00843410,
-    0x10520000, 0x00843410,
-    0x00720000, 0x00843410,
-    0x10920000, 0x00843410,
-    0x00B20000, 0x00843410,
+//*** 2020-12-31   23:58  weekday=4 Do  CET
+    0x7B140000, 0x0482531C,
+    0x6B340000, 0x0482531C,
+    0x00140000, 0x00843410,
+    0x10340000, 0x00843410,
+    0x10540000, 0x00843410,
+    0x00740000, 0x00843410,
+    0x10940000, 0x00843410,
+    0x00B40000, 0x00843410,
 };
 
 long dcf77Data1[16] =                    // Button on PTH.6 pressed
 {   
-//*** 2021-01-12   12:29  weekday=2 Di
-    0x55320000, 0x00842922,
-    0x46120000, 0x00842922,
-    0x56320000, 0x00842922,
-    0x56520000, 0x00842922,
-    0x46720000, 0x00842922,
-    0x56920000, 0x00842922,
-    0x46B20000, 0x00842922,
-    0x46D20000, 0x00842922,
+//*** 2021-01-12   12:29  weekday=2 Di  CET
+    0x55340000, 0x00842922,
+    0x46140000, 0x00842922,
+    0x56340000, 0x00842922,
+    0x56540000, 0x00842922,
+    0x46740000, 0x00842922,
+    0x56940000, 0x00842922,
+    0x46B40000, 0x00842922,
+    0x46D40000, 0x00842922,
 };
 
 long dcf77Data2[16] =                    // Button on PTH.5 pressed
 {   
-//*** 2020-12-01   11:58  weekday=2 Di
-    0x3B120000, 0x04824812,
-    0x2B320000, 0x04824812,
-    0x40120000, 0x04824812,
-    0x50320000, 0x04824812,
-    0x50520000, 0x04824812,
-    0x40720000, 0x04824812,
-    0x50920000, 0x04824812,
-    0x40B20000, 0x04824812,
+//*** 2020-12-01   11:58  weekday=2 Di  CET
+    0x3B140000, 0x04824812,
+    0x2B340000, 0x04824812,
+    0x40140000, 0x04824812,
+    0x50340000, 0x04824812,
+    0x50540000, 0x04824812,
+    0x40740000, 0x04824812,
+    0x50940000, 0x04824812,
+    0x40B40000, 0x04824812,
 };
 
 long dcf77Data3[16] =                    // No button pressed
 {   
-//*** 2020-12-18   23:58  weekday=5 Fr
-    0x7B120000, 0x0482558C,
-    0x6B320000, 0x0482558C,
-    0x00120000, 0x00825990,
-    0x10320000, 0x00825990,
-    0x10520000, 0x00825990,
-    0x00720000, 0x00825990,
-    0x10920000, 0x00825990,
-    0x00B20000, 0x00825990,
+//*** 2020-12-18   23:58  weekday=5 Fr  CET
+    0x7B140000, 0x0482558C,
+    0x6B340000, 0x0482558C,
+    0x00140000, 0x00825990,
+    0x10340000, 0x00825990,
+    0x10540000, 0x00825990,
+    0x00740000, 0x00825990,
+    0x10940000, 0x00825990,
+    0x00B40000, 0x00825990,
 };
 /*  Note: Depending on your implementation of the DCF77 synchronization and decoding, the first
     minute displayed may be one minute later than the values shown in the comments above.
@@ -75,7 +87,104 @@ long dcf77Data3[16] =                    // No button pressed
 
 int dcf77DataMin = 8;                   // ... for 8 minutes
 
+#define SIMSPIKES   50                  // One sample in SIMSPIKES is inverted by a 1ms spike
+
+static char simSignal(void);
+static char simSpike(char signal);
+static char simStep(void);
+
+#ifdef HOST
+/* Changeover scenarios, selected by simScenario, see hostMain.c:
+   The frames are built by encodeDecoderDCF77() for consecutive minutes, starting
+   SCENARIOLEAD minutes before the changeover. Bit 16 or 19 is set in the frames of
+   the hour before it, up to the frame of minute 00. The minute, which sends the
+   frame of minute 00 with bit 19, has 61 seconds with an additional 0 bit in
+   second 59. In the middle of every second, the clock in the DE zone is compared
+   with the simulated time, see scenarioCheck().
+   Holdover scenario: No changeover, the signal is lost after SCENARIOLEARN minutes
+   for simHoldover hours.
+*/
+#define SCENARIOLEAD    10              // Minutes from the start to the changeover
+#define SCENARIOLEARN   (4 * 60)        // Minutes with signal before the holdover
+
+int simScenario = 0;                    // 1..4, 0 -> data sets above
+int simHoldover = 0;                    // Hours without signal of scenario 4
+
+static const DCF77TIME scenarioStart[4] =
+{   { 50, 1, 28, 7,  3, 2021, 0, 0, 0 },    // 1: CET -> CEST, 02:00 CET is 03:00 CEST
+    { 50, 2, 31, 7, 10, 2021, 1, 0, 0 },    // 2: CEST -> CET, 03:00 CEST is 02:00 CET
+    { 50, 0,  1, 7,  1, 2017, 0, 0, 0 },    // 3: Leap second, 00:59:60 CET
+    {  0, 8,  1, 2,  6, 2021, 1, 0, 0 }     // 4: Holdover
+};
+static const char *const scenarioNames[4] = { "CET -> CEST", "CEST -> CET", "leap second", "holdover" };
+
+static DCF77TIME scenarioNow;           // Simulated time of the current minute
+static int scenarioMinute = -1;         // Minutes since the start
+static int scenarioMs = 0;              // Time since the start of the current minute
+static int scenarioLength = 60;         // Seconds of the current minute
+static unsigned char scenarioFrame[DCF77FRAMEBYTES];   // Frame of the next minute
+static long scenarioSynced = -1;        // Seconds since the start of the first correct second
+static unsigned long scenarioChecked, scenarioWrong;
+static long scenarioMaxError, scenarioFirstWrong = -1;
+
+static char scenarioSignal(void);
+static void scenarioFlags(DCF77TIME *time, int minute);
+static void scenarioCheck(int second);
+static long scenarioSeconds(int day, int month, int year, int hours, int minutes, int seconds, int summer);
+#endif
+
+// Simulated DCF77 signal, called every 10ms
 char readPortSim(void)
+{   return simSpike(simStep());
+}
+
+// Simulated DCF77 signal, called every 1ms. The signal changes every 10ms, the spikes every 1ms.
+char readPortSim1ms(void)
+{   static int i1ms = 9;                // Time counter, counts 1ms increments of a 10ms period
+    static char signal = 0x01;
+
+    i1ms = (i1ms + 1) % 10;
+    if (i1ms == 0)
+    {   signal = simStep();
+    }
+    return simSpike(signal);
+}
+
+// Signal at the actual time. In the host build, the simulation is advanced by the 10ms
+// steps of the true time elapsed meanwhile, i.e. 0, 1 or 2 steps, see halDrift. With
+// input capture, halHost.c already calls readPortSim() every 10ms of the true time.
+static char simStep(void)
+{
+#if defined(HOST) && !defined(DCF77CAPTURE)
+    static unsigned long long first;    // Time of the first call
+    static unsigned long steps = 0;
+    static char signal = 0x01;
+    unsigned long due;
+
+    if (steps == 0)
+    {   first = halCycles;
+    }
+    due = 1 + (unsigned long) ((halCycles - first + HALSOURCEPERIOD / 2) / (HALSOURCEPERIOD * (1.0 + halDrift * 1e-6)));
+    while (steps < due)
+    {   steps++;
+        signal = simSignal();
+    }
+    return signal;
+#else
+    return simSignal();
+#endif
+}
+
+// Simulate short spikes by pressing the button on PTH.3, a 10ms sample hits a 1ms spike
+// with the same probability as a 1ms sample
+static char simSpike(char signal)
+{   if ((PTH & 0x08) && rand() < RAND_MAX / SIMSPIKES)
+    {   return (char) (signal ^ 0x01);
+    }
+    return signal;
+}
+
+static char simSignal(void)
 {   static int i10ms = 9;               // Time counter, counts  10ms increments of a 100ms period
     static int i100ms =9;               //               counts 100ms increments of a 1s    period
     static int iSec  = 45;              //               counts 1s    increments of a 1min  period
@@ -92,6 +201,11 @@ char readPortSim(void)
         }
     }
 
+#ifdef HOST
+    if (simScenario)                    // Changeover scenario instead of the data sets
+    {   signal = scenarioSignal();
+    } else
+#endif
     if (iSec < 59)                      // If it is not the last second of a minute
     {   if (i100ms < 1)                 // ... and if we are at the first 100ms of a second
         {   signal = 0;                 // ...... output Low
@@ -125,5 +239,106 @@ char readPortSim(void)
 }
 
 void initializePortSim(void) {
-    DDRH = DDRH & 0b11111100;
-}
\ No newline at end of file
+    DDRH = DDRH & 0b11110100;
+}
+
+#ifdef HOST
+// Simulated DCF77 signal of the changeover scenario, called every 10ms
+static char scenarioSignal(void)
+{   DCF77TIME next;
+    int second, ms;
+
+    // NEW MINUTE: SEND THE FRAME OF THE NEXT MINUTE
+    if (scenarioMinute < 0 || scenarioMs >= scenarioLength * 1000)
+    {   if (scenarioMinute < 0)
+        {   scenarioNow = scenarioStart[simScenario - 1];
+        } else
+        {   advanceDecoderDCF77(&scenarioNow, 1);
+        }
+        scenarioMinute++;
+        scenarioMs = 0;
+        scenarioFlags(&scenarioNow, scenarioMinute);
+        next = scenarioNow;
+        advanceDecoderDCF77(&next, 1);
+        scenarioFlags(&next, scenarioMinute + 1);
+        encodeDecoderDCF77(scenarioFrame, &next);
+        scenarioLength = next.leap && next.minute == 0 ? 61 : 60;
+    }
+    second = scenarioMs / 1000;
+    ms = scenarioMs % 1000;
+    scenarioMs += 10;
+
+    if (ms == 500)
+    {   scenarioCheck(second);
+    }
+    if (simScenario == 4 && scenarioMinute >= SCENARIOLEARN && scenarioMinute < SCENARIOLEARN + simHoldover * 60)
+    {   return 1;                       // No signal during the holdover
+    }
+    if (second > 59 || (second == 59 && scenarioLength == 60))
+    {   return 1;                       // No pulse before the minute marker
+    }
+    if (ms < 100)
+    {   return 0;
+    }
+    if (ms < 200 && second < DCF77FRAMEBITS && (scenarioFrame[second >> 3] >> (second & 7)) & 1)
+    {   return 0;
+    }
+    return 1;
+}
+
+// Announcement bits of a minute of the changeover scenario
+static void scenarioFlags(DCF77TIME *time, int minute)
+{   time->announce = (char) (simScenario <= 2 && minute <= SCENARIOLEAD);
+    time->leap = (char) (simScenario == 3 && minute <= SCENARIOLEAD);
+}
+
+// Compare the clock with the simulated time in second 0..60 of the current minute.
+// Both are counted in seconds since the start including the leap second.
+static void scenarioCheck(int second)
+{   CLOCKTIME clock;
+    long start, now, error;
+    const DCF77TIME *first = &scenarioStart[simScenario - 1];
+    int leap = simScenario == 3;
+
+    start = scenarioSeconds(first->day, first->month, first->year, first->hour, first->minute, 0, first->summer);
+    now = scenarioMinute * 60L + second + (leap && scenarioMinute >= SCENARIOLEAD);
+    getClockZone(CLOCKZONEDE, 0, &clock);
+    error = scenarioSeconds(clock.days, clock.months, clock.years, clock.hrs, clock.mins,
+                            clock.secs > 59 ? 59 : clock.secs, clock.dst) - start;
+    error = error + (clock.secs > 59) + (leap && error >= SCENARIOLEAD * 60L) - now;
+
+    if (scenarioSynced < 0)
+    {   if (error != 0)
+            return;
+        scenarioSynced = now;
+    }
+    scenarioChecked++;
+    if (error != 0)
+    {   scenarioWrong++;
+        if (scenarioFirstWrong < 0)
+            scenarioFirstWrong = now;
+    }
+    if (labs(error) > scenarioMaxError)
+        scenarioMaxError = labs(error);
+}
+
+// Seconds of a DE time since 1 March 2000, counted in UTC, without leap seconds
+static long scenarioSeconds(int day, int month, int year, int hours, int minutes, int seconds, int summer)
+{   long days;
+
+    year = year - 2000 - (month <= 2);
+    days = 365L * year + year / 4 - year / 100 + (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    return days * 86400L + hours * 3600L + minutes * 60L + seconds - (summer ? 7200L : 3600L);
+}
+
+// Print the result of the changeover scenario
+void printScenarioSim(void)
+{   if (!simScenario)
+        return;
+    printf("Changeover:        %s, synced after %ld s, %lu seconds checked, %lu wrong",
+           scenarioNames[simScenario - 1], scenarioSynced, scenarioChecked, scenarioWrong);
+    if (scenarioWrong)
+        printf(" from %ld s", scenarioFirstWrong);
+    printf(", max. error %ld s\n", scenarioMaxError);
+}
+#endif
\ No newline at end of file
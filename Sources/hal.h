@@ -0,0 +1,67 @@
+/*  Header for Hardware Abstraction Layer (HAL)
+
+    Computerarchitektur / Computer Architecture
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
+    Hochschule Esslingen
+
+    Target build (CodeWarrior):
+    Only the common defines and the CPU specific register defines are included,
+    i.e. every register access is still a direct memory mapped access, there is
+    no run time or code size overhead.
+
+    Host build (compiler flag HOST, e.g. gcc on Linux):
+    The registers used by the firmware are plain memory variables, see halHost.c.
+    Time is virtual. halIdle() and halWait() advance the virtual time to the next
+    timer event and call the interrupt service routine, see halHost.c and hostMain.c.
+    Busy wait loops call halSpin(). Code driving the LCD calls halLcdBus() after each
+    change of the control lines, so that the display model can follow the bus.
+*/
+
+#ifndef HAL_H
+#define HAL_H
+
+#ifndef HOST
+// ---- Target: CodeWarrior HCS12 ---------------------------------------------
+#include <hidef.h>                              // Common defines
+#include <mc9s12dp256.h>                        // CPU specific defines
+
+#define HAL_ISR(vector)     interrupt vector    // Interrupt service routine
+#define halIdle()                               // Nothing to do, the OS loop keeps polling
+#define halWait()           {__asm CLI; __asm WAI;} // Enable interrupts and sleep until the next one
+#define halSpin()                               // Nothing to do, busy wait loops poll TCNT or the port
+#define halLcdBus()                             // Nothing to do, the display is connected to the port
+#define halTask()                               // Nothing to do, tasks take real time
+#define halTick()                               // Nothing to do, tick10ms() takes real time
+#define halCheckInterrupts()                    // Nothing to do, checked in the host build only
+
+#else
+// ---- Host: memory backed registers and virtual time ------------------------
+#include <stddef.h>                             // NULL
+
+typedef unsigned char  halReg8;
+typedef unsigned short halReg16;
+
+extern volatile halReg8  PORTA, DDRA, PORTB, DDRB, PORTK, DDRK;
+extern volatile halReg8  PTH, DDRH, PTJ, DDRJ, PTP, DDRP;
+extern volatile halReg8  PTT, DDRT;
+extern volatile halReg8  TSCR1, TSCR2, TIOS, TIE, TCTL1, TCTL4, TFLG1;
+extern volatile halReg16 TCNT, TC1, TC4, TC5, TC6;
+
+extern volatile char halInterruptsEnabled;      // Emulated CCR I-bit (inverted)
+
+#define EnableInterrupts    (halInterruptsEnabled = 1)
+#define DisableInterrupts   (halInterruptsEnabled = 0)
+
+#define HAL_ISR(vector)                         // Plain function on the host
+
+void halIdle(void);                             // Advance virtual time to the next interrupt
+void halWait(void);                             // Enable interrupts and advance to the next interrupt
+void halSpin(void);                             // Advance virtual time by one timer count (busy wait loops)
+void halLcdBus(void);                           // LCD control lines changed, see hd44780Host.c
+void halTask(void);                             // Task finished, spend its virtual run time, see halHost.c
+void halTick(void);                             // tick10ms() finished, spend its virtual run time, see halHost.c
+void halCheckInterrupts(void);                  // Abort, if the interrupts are disabled, see halHost.c
+
+#endif
+
+#endif
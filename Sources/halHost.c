@@ -0,0 +1,223 @@
+/*  Hardware Abstraction Layer (HAL) - Host emulation
+
+    Computerarchitektur / Computer Architecture
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
+    Hochschule Esslingen
+
+    Only used for the host build (compiler flag HOST), not part of the target build.
+
+    The HCS12 registers used by the firmware are emulated as plain memory variables.
+    The Enhanced Capture Timer (ECT) is emulated in virtual time: halCycles counts
+    bus clock cycles (24 MHz), TCNT is derived from it using the prescaler in TSCR2.
+    halIdle() is called by the OS loop whenever the firmware is waiting. It advances
+    the virtual time directly to the next output compare event and calls the
+    associated interrupt service routine, i.e. no wall clock time is spent waiting.
+    Task execution itself takes no virtual time, unless halTaskLoad is set: then
+    halTask() spends halTaskLoad timer counts after every task call, with interrupts
+    enabled, e.g. to model a slow display task. Likewise halTick() spends halTickLoad
+    timer counts after every HALTICKEVERY-th call of tick10ms(), with interrupts disabled,
+    e.g. to model a decoder, which overruns the 10ms tick once per second.
+    Busy wait loops call halSpin(), which advances the virtual time by one timer count.
+    Optionally an input signal on port T.1 is sampled every 10ms from halPT1Source,
+    edges are latched into TC1, if channel 1 is set up for input capture.
+    The virtual time is the time of the local crystal. halDrift is its frequency error,
+    the input signal is sampled every 10ms of the true time, i.e. every 10ms * (1 + halDrift).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal.h"
+#include "halHost.h"
+
+// Defines
+#define TIMER_ON    0x80                        // TSCR1 timer enable bit
+#define PRESCALER   0x07                        // TSCR2 prescaler bits
+
+// Emulated registers
+volatile halReg8  PORTA, DDRA, PORTB, DDRB, PORTK, DDRK;
+volatile halReg8  PTH, DDRH, PTJ, DDRJ, PTP, DDRP;
+volatile halReg8  PTT, DDRT;
+volatile halReg8  TSCR1, TSCR2, TIOS, TIE, TCTL1, TCTL4, TFLG1;
+volatile halReg16 TCNT, TC1, TC4, TC5, TC6;
+
+volatile char halInterruptsEnabled = 0;
+
+// Virtual time and statistics
+unsigned long long halCycles = 0;               // Bus clock cycles since reset
+unsigned long long halEndCycles = 0;            // Simulation ends at this time, 0 = never
+unsigned long halInterruptCount = 0;            // Number of interrupt service routine calls
+unsigned int halTaskLoad = 0;                   // Virtual run time of each task call in timer counts
+unsigned int halTickLoad = 0;                   // Virtual run time of every HALTICKEVERY-th tick10ms() call
+double halDrift = 0.0;                          // Frequency error of the local crystal in ppm
+
+// Input signal on port T.1, sampled every HALSOURCEPERIOD, see hostMain.c
+char (*halPT1Source)(void) = NULL;
+static unsigned long long halSourceNext = HALSOURCEPERIOD;
+static unsigned long long halSourceCount = 1;   // Samples of the input signal so far
+
+static halReg8 halPending = 0;                  // Pending interrupt flags
+
+// Interrupt service routines of the ECT channels, see ticker.c, dcf77.c and lcd.c.
+// Weak references, the optional ones are NULL, if not part of the build.
+void isrECT1(void) __attribute__((weak));
+void isrECT4(void);
+void isrECT5(void);
+void isrECT6(void) __attribute__((weak));
+
+static volatile halReg16 *const halTC[8] = { 0, &TC1, 0, 0, &TC4, &TC5, &TC6, 0 };
+static void (*const halISR[8])(void)     = { 0, isrECT1, 0, 0, isrECT4, isrECT5, isrECT6, 0 };
+
+
+// Update TCNT from the virtual time
+static void halUpdateTCNT(void)
+{   if (TSCR1 & TIMER_ON)
+    {   TCNT = (halReg16) (halCycles >> (TSCR2 & PRESCALER));
+    }
+}
+
+// Raise the interrupt flag of an ECT channel
+static void halRaise(int ch)
+{   halPending = halPending | (1 << ch);
+    TFLG1 = TFLG1 | (1 << ch);
+}
+
+// Call the interrupt service routines of all pending and enabled ECT channels
+// The pending flags are kept in halPending, because a memory variable cannot
+// emulate the write-one-to-clear behaviour of TFLG1.
+static void halServeInterrupts(void)
+{   int ch;
+
+    for (ch = 0; ch < 8; ch++)
+    {   if (halISR[ch] && (halPending & TIE & (1 << ch)) && halInterruptsEnabled)
+        {   halInterruptCount++;
+            halPending = halPending & ~(1 << ch);   // The ISR acknowledges by writing a 1
+            halISR[ch]();
+            TFLG1 = halPending;
+        }
+    }
+}
+
+// Advance the virtual time to the next timer or input event, but not beyond limit
+// (0 = no limit), and serve it
+static void halStep(unsigned long long limit)
+{   unsigned long counts, best = 0;
+    unsigned long long next;
+    int ch, prescaler;
+    halReg8 level, edges;
+
+    prescaler = TSCR2 & PRESCALER;
+    if (TSCR1 & TIMER_ON)
+    {   for (ch = 0; ch < 8; ch++)              // Find the next compare match
+        {   if (halTC[ch] && (TIOS & TIE & (1 << ch)))
+            {   counts = (halReg16) (*halTC[ch] - TCNT);
+                if (counts == 0)
+                    counts = 0x10000;           // Compare match only after a full wrap
+                if (best == 0 || counts < best)
+                    best = counts;
+            }
+        }
+    }
+
+    if (best == 0 && halPT1Source == NULL && limit == 0)
+    {   hostExit();                             // Nothing will ever happen again
+    }
+
+    next = ((halCycles >> prescaler) + best) << prescaler;
+    if (halPT1Source && (best == 0 || halSourceNext < next))
+    {   next = halSourceNext;                   // The input signal changes first
+    }
+    if (limit && (next > limit || (best == 0 && halPT1Source == NULL)))
+    {   next = limit;
+    }
+    if (halEndCycles && next > halEndCycles)
+    {   halCycles = halEndCycles;
+        halUpdateTCNT();
+        hostExit();
+    }
+
+    halCycles = next;
+    halUpdateTCNT();
+
+    if (halPT1Source && halCycles == halSourceNext) // Sample the input signal on port T.1
+    {   halSourceCount++;
+        halSourceNext = (unsigned long long) (halSourceCount * (double) HALSOURCEPERIOD * (1.0 + halDrift * 1e-6) + 0.5);
+        level = halPT1Source() ? 0x02 : 0x00;
+        if ((PTT & 0x02) != level)
+        {   PTT = (PTT & ~0x02) | level;
+            edges = level ? 0x04 : 0x08;        // TCTL4 EDG1A rising, EDG1B falling
+            if ((TSCR1 & TIMER_ON) && !(TIOS & 0x02) && (TCTL4 & edges))
+            {   TC1 = TCNT;                     // Input capture
+                halRaise(1);
+            }
+        }
+    }
+    for (ch = 0; ch < 8; ch++)                  // Raise the flags of all matching channels
+    {   if (halTC[ch] && (TIOS & (1 << ch)) && *halTC[ch] == TCNT)
+        {   halRaise(ch);
+        }
+    }
+    halServeInterrupts();
+}
+
+// Advance the virtual time to the next timer or input event and serve it.
+// Returns, after at least one interrupt service routine has been called.
+void halIdle(void)
+{   unsigned long served = halInterruptCount;
+
+    halServeInterrupts();                       // Anything pending, e.g. after EnableInterrupts
+    while (halInterruptCount == served)
+    {   halStep(0);
+    }
+}
+
+// Advance the virtual time by one timer count, called by busy wait loops
+void halSpin(void)
+{   halStep(((halCycles >> (TSCR2 & PRESCALER)) + 1) << (TSCR2 & PRESCALER));
+}
+
+// Spend the virtual run time of a task call, the interrupts are served meanwhile
+void halTask(void)
+{   unsigned long long end;
+
+    if (halTaskLoad == 0)
+        return;
+    end = halCycles + ((unsigned long long) halTaskLoad << (TSCR2 & PRESCALER));
+    while (halCycles < end)
+    {   halStep(end);
+    }
+}
+
+// Spend the virtual run time of a tick10ms() call in the ticker ISR. The interrupts stay
+// disabled, compare events meanwhile only raise their flags.
+void halTick(void)
+{   static unsigned int calls = 0;
+    unsigned long long end;
+    char enabled;
+
+    if (halTickLoad == 0 || ++calls < HALTICKEVERY)
+        return;
+    calls = 0;
+    enabled = halInterruptsEnabled;
+    DisableInterrupts;
+    end = halCycles + ((unsigned long long) halTickLoad << (TSCR2 & PRESCALER));
+    while (halCycles < end)
+    {   halStep(end);
+    }
+    halInterruptsEnabled = enabled;
+}
+
+// Check, that a function, which waits for an interrupt, is called with interrupts enabled.
+// Otherwise it would wait forever on the target.
+void halCheckInterrupts(void)
+{   if (!halInterruptsEnabled)
+    {   fprintf(stderr, "Waiting for an interrupt with interrupts disabled\n");
+        abort();
+    }
+}
+
+// Emulation of the WAI instruction with interrupts enabled, see halWait() in hal.h
+void halWait(void)
+{   EnableInterrupts;
+    halIdle();
+}
@@ -0,0 +1,40 @@
+/*  Header for the host emulation of the Hardware Abstraction Layer (HAL)
+
+    Computerarchitektur / Computer Architecture
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
+    Hochschule Esslingen
+
+    Only used for the host build (compiler flag HOST).
+*/
+
+#define HALBUSCLOCK 24000000UL                  // Bus clock frequency in Hz
+#define HALSOURCEPERIOD (HALBUSCLOCK / 100)     // Sampling period of the input signal source, 10ms
+#define HALTICKEVERY 100                        // halTickLoad is spent every 100th tick10ms() call, 1s
+
+// Virtual time and statistics, for details see halHost.c
+extern unsigned long long halCycles;
+extern unsigned long long halEndCycles;
+extern unsigned long halInterruptCount;
+extern unsigned int halTaskLoad;
+extern unsigned int halTickLoad;
+extern double halDrift;
+extern char (*halPT1Source)(void);
+
+// HD44780 display model, for details see hd44780Host.c
+extern unsigned long hd44780Writes;
+extern unsigned long hd44780Reads;
+extern unsigned long hd44780Violations;
+extern unsigned long long hd44780BusyCycles;
+void hd44780Line(unsigned char line, char *text);
+
+// DCF77 decoder benchmarks, for details see dcf77Bench.c
+void benchDCF77(unsigned long minutes);
+void benchSyncDCF77(double ber);
+void benchMatchDCF77(double ber);
+void benchBurstDCF77(int burst);
+void benchSkewDCF77(int skew);
+void benchOversampleDCF77(double rate);
+
+// Provided by the simulation driver, for details see hostMain.c
+void firmwareMain(void);                        // main() of the firmware, see main.c
+void hostExit(void);                            // Called at the end of the simulation, does not return
@@ -0,0 +1,104 @@
+/*  HD44780 LCD controller model for the host build
+
+    Computerarchitektur / Computer Architecture
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
+    Hochschule Esslingen
+
+    Only used for the host build (compiler flag HOST), not part of the target build.
+
+    Models the display as connected in the simulator build of lcd.c: 8-bit data on
+    port K, control lines on port A (bit 0: RS, bit 1: R/W, bit 2: E). lcd.c calls
+    halLcdBus() after each change of port A.
+    Writes are latched on the falling edge of E. Reads (R/W=1) put the busy flag
+    and the address counter on port K with the rising edge of E.
+    The execution times are the data sheet values at 270 kHz oscillator frequency.
+    Writes while the controller is busy are ignored like by the real controller
+    and counted in hd44780Violations.
+*/
+
+#include "hal.h"
+#include "halHost.h"
+
+// Defines, execution times in bus cycles
+#define CTRLRS      0x01
+#define CTRLRW      0x02
+#define CTRLE       0x04
+#define EXECTIME    (37UL * (HALBUSCLOCK / 1000000UL))      // 37us
+#define EXECLONG    (1520UL * (HALBUSCLOCK / 1000000UL))    // 1.52ms clear display, return home
+
+// Display model
+static char hd44780Ram[0x80];                   // Display data RAM, line 0 at 0x00, line 1 at 0x40
+static unsigned char hd44780Address = 0;        // Address counter
+static unsigned char hd44780Ctrl = 0;           // Last state of the control lines
+static unsigned long long hd44780BusyUntil = 0; // Controller busy until this time (halCycles)
+
+// Statistics
+unsigned long hd44780Writes = 0;                // Commands and data written
+unsigned long hd44780Reads = 0;                 // Busy flag reads
+unsigned long hd44780Violations = 0;            // Writes while busy, i.e. lost
+unsigned long long hd44780BusyCycles = 0;       // Total execution time
+
+// Internal function: next address in 2 line mode, line 0: 0x00..0x27, line 1: 0x40..0x67
+static unsigned char hd44780Next(unsigned char address)
+{   address++;
+    if (address == 0x28)
+        return 0x40;
+    if (address == 0x68)
+        return 0x00;
+    return address;
+}
+
+// Internal function: execute a command or write data
+static void hd44780Execute(unsigned char rs, unsigned char data)
+{   unsigned long time = EXECTIME;
+    int i;
+
+    if (rs)                                     // Write data to RAM
+    {   hd44780Ram[hd44780Address & 0x7F] = (char) data;
+        hd44780Address = hd44780Next(hd44780Address);
+    } else if (data & 0x80)                     // Set RAM address
+    {   hd44780Address = data & 0x7F;
+    } else if (data == 0x01)                    // Clear display
+    {   for (i = 0; i < 0x80; i++)
+            hd44780Ram[i] = ' ';
+        hd44780Address = 0;
+        time = EXECLONG;
+    } else if ((data & 0xFE) == 0x02)           // Return home
+    {   hd44780Address = 0;
+        time = EXECLONG;
+    }                                           // Function set, display control, entry mode: no state
+
+    hd44780Writes++;
+    hd44780BusyCycles += time;
+    hd44780BusyUntil = halCycles + time;
+}
+
+// Host HAL function: halLcdBus ... The control lines on port A may have changed
+void halLcdBus(void)
+{   unsigned char ctrl = PORTA;
+    int busy = halCycles < hd44780BusyUntil;
+
+    if ((ctrl & CTRLE) && !(hd44780Ctrl & CTRLE) && (ctrl & CTRLRW))
+    {   PORTK = (busy ? 0x80 : 0x00) | hd44780Address;   // Read busy flag and address
+        hd44780Reads++;
+    }
+    if (!(ctrl & CTRLE) && (hd44780Ctrl & CTRLE) && !(hd44780Ctrl & CTRLRW))
+    {   if (busy)                               // Latch the data, if not busy
+            hd44780Violations++;
+        else
+            hd44780Execute(hd44780Ctrl & CTRLRS, PORTK);
+    }
+    hd44780Ctrl = ctrl;
+}
+
+// Host function: hd44780Line ... Copy a line of the display (16 characters + '\0')
+void hd44780Line(unsigned char line, char *text)
+{   int i;
+
+    for (i = 0; i < 16; i++)
+    {   text[i] = hd44780Ram[(line ? 0x40 : 0x00) + i];
+        if (text[i] < ' ')
+            text[i] = ' ';
+    }
+    text[16] = 0;
+}
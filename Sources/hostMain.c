@@ -0,0 +1,310 @@
+/*  Host simulation driver for the radio signal clock
+
+    Computerarchitektur / Computer Architecture
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
+    Hochschule Esslingen
+
+    Runs the complete firmware natively on a Linux host in virtual time, see halHost.c.
+    The DCF77 signal is generated by the simulation in dcf77Sim.c, the simulator
+    buttons on port H can be set from the command line.
+
+    Build:  gcc -O2 -DHOST -DSIMULATOR -o funkuhr Sources/main.c Sources/clock.c
+                Sources/dcf77.c Sources/dcf77Decoder.c Sources/dcf77Sim.c Sources/lcd.c
+                Sources/led.c Sources/os.c Sources/ticker.c Sources/halHost.c
+                Sources/hd44780Host.c Sources/dcf77Bench.c Sources/hostMain.c -lm
+            Optional flags: -DOSBUSYPOLL   (original busy polling scheduler)
+                            -DOSSTATS      (scheduler statistics)
+                            -DTICKLESS     (tickless ticker, see ticker.c)
+                            -DDCF77CAPTURE (DCF77 edges by input capture, see dcf77.c)
+                            -DLCDBUSYFLAG  (LCD busy flag polling, see lcd.c)
+                            -DCLOCKSPRINTF (original sprintf display formatting, see clock.c)
+                            -DDCF77SOFT    (soft decision DCF77 decoding, see dcf77Decoder.c)
+                            -DDCF77STITCH  (DCF77 partial frame stitching, see dcf77Decoder.c)
+                            -DDCF77ADAPTIVE (adaptive DCF77 pulse classification, see dcf77Decoder.c)
+                            -DDCF77OVERSAMPLE (1ms DCF77 oversampling with glitch filter, see dcf77.c)
+                            -DCLOCKDISCIPLINE (crystal frequency correction by DCF77, see clock.c)
+                            -DOSPROFILE    (run time profiles of the tasks and ISRs, see os.c)
+
+    Usage:  funkuhr [-t seconds] [-p pth] [-s seed] [-b count] [-d minutes] [-e ber] [-m ber] [-f burst] [-w skew] [-o rate] [-l counts] [-c scenario] [-x ppm] [-h hours] [-r count] [-i counts]
+                -t  Virtual run time in seconds, default 86400 (one day)
+                -p  Value of port H (simulator buttons), e.g. 0x02 for a noisy signal,
+                    0x04 to step through the zones DE, US, UK, JP every second,
+                    0x08 for 1ms spikes
+                -s  Seed of the random generator used by the noise simulation
+                -c  Changeover scenario of the simulated signal instead of the data sets,
+                    1 for CET -> CEST, 2 for CEST -> CET, 3 for a leap second, see
+                    dcf77Sim.c. The changeover is 10 minutes after the start, e.g. run
+                    with -t 1800. Prints the error of the clock checked every second.
+                -x  Frequency error of the crystal in ppm, e.g. 20 for a crystal, which
+                    is fast by 20ppm, see halDrift in halHost.c
+                -h  Holdover: 4 hours of signal, then the given hours without signal,
+                    then the first synchronization again, see dcf77Sim.c. Sets the run
+                    time and prints how far the clock was off, e.g. -x 20 -h 24. Build
+                    with and without -DCLOCKDISCIPLINE to compare.
+                -l  Virtual run time of every task call in timer counts (5.33us), e.g.
+                    4000 for a scheduler, which is late by more than 10ms, see halTask()
+                -i  Virtual run time of every 100th tick10ms() call in timer counts, e.g.
+                    4000 for a decoder, which overruns the 10ms tick once per second,
+                    see halTick() and tickerCatchUp() in ticker.c
+                -b  Benchmark: call displayDateTimeClock() count times, print the time
+                    per call and exit. Build with and without -DCLOCKSPRINTF to compare
+                    the formatters, the code size is printed by "size clock.o".
+                    These are host figures. The HCS12 cost comes from the CodeWarrior
+                    build: the cycles of one call from the cycle counter of the
+                    simulator (breakpoints before and after displayDateTimeClock()),
+                    ROM and RAM from the linker map, including sprintf and vprintf of
+                    the library with -DCLOCKSPRINTF.
+                -d  Benchmark: push the given number of minutes of DCF77 signal through
+                    the decoder, see dcf77Bench.c, print the throughput and exit
+                -e  Benchmark: time to sync of the DCF77 decoder at the given bit error
+                    rate, e.g. 0.05, see dcf77Bench.c
+                -m  Benchmark: predicted frame matching compared to the parity check
+                    at the given bit error rate, see dcf77Bench.c
+                -f  Benchmark: time to the first fix of the DCF77 decoder with a burst
+                    error of the given length in seconds every minute, see dcf77Bench.c
+                -w  Benchmark: pulse classification error rate of a receiver, which
+                    lengthens all low pulses by the given skew in ms, see dcf77Bench.c
+                -o  Benchmark: 10ms sampling compared to 1ms oversampling with glitch
+                    filter at the given spike rate per 1ms sample, see dcf77Bench.c
+                -r  Benchmark: overhead of the run time profiler, count measurements.
+                    Build with -DOSPROFILE. The profiles of a normal run are printed
+                    at the end, the tasks need a virtual run time, e.g. -l 400.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hal.h"
+#include "halHost.h"
+#include "os.h"
+#include "dcf77.h"
+#include "lcd.h"
+#include "clock.h"
+#include "ticker.h"
+
+static struct timespec wallStart;
+
+// Benchmark the display formatting, the LCD shadow buffer suppresses the bus
+// writes after the first call, so mainly the formatting is measured
+static void benchmarkDisplay(unsigned long count)
+{   struct timespec start, end;
+    unsigned long i;
+    double ns;
+
+    setClock(19, 12, 2020, 23, 59, 58);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < count; i++)
+    {   displayDateTimeClock(UPDATEDISPLAY);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / count;
+
+#ifdef CLOCKSPRINTF
+    printf("Formatter:         sprintf\n");
+#else
+    printf("Formatter:         lookup table\n");
+#endif
+    printf("displayDateTimeClock: %lu calls, %.1f ns per call\n", count, ns);
+}
+
+#ifdef OSPROFILE
+static const char *const profileNames[OSPROFILES] =
+{   "clock", "DCF77", "display", "task 3", "task 4", "task 5", "task 6", "task 7",
+    "isrECT4", "isrECT1", "isrECT6"
+};
+
+// Benchmark the profiler, the time of osProfileStart() and osProfileEnd() per measurement
+static void benchmarkProfile(unsigned long count)
+{   struct timespec start, end;
+    unsigned long i;
+    double ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < count; i++)
+    {   osProfileStart(OSPROFILETICKER);
+        TCNT = (halReg16) (TCNT + (i & 0x3FF));     // Spread the run times over the buckets
+        osProfileEnd(OSPROFILETICKER);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / count;
+
+    printf("Profiler:          %lu measurements, %.1f ns per measurement\n", count, ns);
+    printf("Profiler memory:   %u bytes per profile on the host, %u profiles\n", (unsigned) sizeof(osProfile), OSPROFILES);
+}
+
+// Print the run time profiles of the tasks and interrupt service routines
+static void printProfiles(void)
+{   osProfile profile;
+    unsigned char i, k;
+
+    for (i = 0; i < OSPROFILES; i++)
+    {   osProfileRead(i, &profile);
+        if (profile.count == 0)
+            continue;
+        printf("Profile %-10s %lu runs, min %.1f, mean %.1f, max %.1f us\n", profileNames[i], profile.count,
+               profile.min * 16.0 / 3, (double) profile.sum / profile.count * 16.0 / 3, profile.max * 16.0 / 3);
+        printf("                  ");
+        for (k = 0; k < OSPROFILEBUCKETS; k++)
+        {   if (profile.histogram[k])
+                printf(" <%lu:%lu", 2UL << k, profile.histogram[k]);
+        }
+        printf(" (TCNT counts:runs)\n");
+    }
+}
+#endif
+
+// Print the simulation statistics and terminate
+void hostExit(void)
+{   struct timespec wallEnd;
+    double wall, virt;
+    char line[17];
+
+    clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    wall = (wallEnd.tv_sec - wallStart.tv_sec) + (wallEnd.tv_nsec - wallStart.tv_nsec) * 1e-9;
+    virt = (double) halCycles / HALBUSCLOCK;
+
+    printf("Virtual time:      %.3f s\n", virt);
+    printf("Wall clock time:   %.3f s\n", wall);
+    printf("Speedup:           %.0f x\n", wall > 0 ? virt / wall : 0.0);
+    printf("Interrupts:        %lu\n", halInterruptCount);
+    printf("LEDs (PORTB):      0x%02X\n", PORTB);
+    printf("LCD bus writes:    %lu (%lu avoided)\n", lcdBusWrites, lcdBusWritesAvoided);
+    printf("HD44780:           %lu writes, %lu busy flag reads, %lu lost, busy %.3f s\n",
+           hd44780Writes, hd44780Reads, hd44780Violations, (double) hd44780BusyCycles / HALBUSCLOCK);
+    hd44780Line(0, line);
+    printf("Display:           [%s]\n", line);
+    hd44780Line(1, line);
+    printf("                   [%s]\n", line);
+    printf("Event queues:      clock %lu lost, backlog %u, DCF77 %lu lost, backlog %u\n",
+           clockQueue.osOverflows, clockQueue.osBacklog, dcf77Queue.osOverflows, dcf77Queue.osBacklog);
+    printf("Ticker overruns:   %lu, %lu ticks caught up\n", tickerOverruns, tickerMissed);
+    printf("Clock sync:        off by %+ld s %+ld timer counts at the last synchronization\n",
+           clockCorrectionSeconds, clockCorrection);
+    printScenarioSim();
+    if (simScenario == 4)
+    {
+#ifdef CLOCKDISCIPLINE
+        printf("Holdover:          %d h, crystal %+.1f ppm, trim %+.2f ppm, clock off by %+.1f ms\n",
+               simHoldover, halDrift, clockTrim / 65536.0 / 1875.0 * 1e6,
+               clockCorrectionSeconds * 1000.0 + clockCorrection / 187.5);
+#else
+        printf("Holdover:          %d h, crystal %+.1f ppm, no trim, clock off by %+.1f ms\n",
+               simHoldover, halDrift, clockCorrectionSeconds * 1000.0 + clockCorrection / 187.5);
+#endif
+    }
+#if defined(DCF77OVERSAMPLE) && !defined(DCF77CAPTURE)
+    printf("DCF77 edge overflows: %lu\n", dcf77EdgeOverflows);
+#endif
+#ifdef OSPROFILE
+    printProfiles();
+#endif
+#ifdef OSSTATS
+    printf("Scheduler passes:  %lu\n", osStats.passes);
+    printf("Task dispatches:   %lu\n", osStats.dispatches);
+    printf("Idle fraction:     %.4f\n", osStats.totalTime ? (double) osStats.idleTime / osStats.totalTime : 0.0);
+    printf("Dispatch latency:  mean %.1f, max %u TCNT counts\n",
+           osStats.dispatches ? (double) osStats.latencySum / osStats.dispatches : 0.0, osStats.latencyMax);
+#endif
+    exit(0);
+}
+
+int main(int argc, char *argv[])
+{   double seconds = 86400.0;
+    unsigned long benchmark = 0, minutes = 0, profile = 0;
+    double ber = -1.0, matchBer = -1.0, spikeRate = -1.0;
+    int burst = -1, skew = 0, skewBench = 0;
+    int i;
+
+    for (i = 1; i + 1 < argc; i += 2)
+    {   if (argv[i][0] == '-' && argv[i][1] == 't')
+        {   seconds = atof(argv[i+1]);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'p')
+        {   PTH = (halReg8) strtoul(argv[i+1], NULL, 0);
+        } else if (argv[i][0] == '-' && argv[i][1] == 's')
+        {   srand((unsigned) strtoul(argv[i+1], NULL, 0));
+        } else if (argv[i][0] == '-' && argv[i][1] == 'c' && atoi(argv[i+1]) >= 1 && atoi(argv[i+1]) <= 3)
+        {   simScenario = atoi(argv[i+1]);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'r')
+        {   profile = strtoul(argv[i+1], NULL, 0);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'x')
+        {   halDrift = atof(argv[i+1]);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'h' && atoi(argv[i+1]) >= 0)
+        {   simScenario = 4;
+            simHoldover = atoi(argv[i+1]);
+            seconds = (4 + simHoldover) * 3600.0 + 150.0;   // ... until the first frame after the holdover
+        } else if (argv[i][0] == '-' && argv[i][1] == 'l')
+        {   halTaskLoad = (unsigned int) strtoul(argv[i+1], NULL, 0);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'i')
+        {   halTickLoad = (unsigned int) strtoul(argv[i+1], NULL, 0);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'b')
+        {   benchmark = strtoul(argv[i+1], NULL, 0);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'd')
+        {   minutes = strtoul(argv[i+1], NULL, 0);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'e')
+        {   ber = atof(argv[i+1]);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'm')
+        {   matchBer = atof(argv[i+1]);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'f')
+        {   burst = atoi(argv[i+1]);
+        } else if (argv[i][0] == '-' && argv[i][1] == 'w')
+        {   skew = atoi(argv[i+1]);
+            skewBench = 1;
+        } else if (argv[i][0] == '-' && argv[i][1] == 'o')
+        {   spikeRate = atof(argv[i+1]);
+        } else
+        {   fprintf(stderr, "Usage: %s [-t seconds] [-p pth] [-s seed] [-b count] [-d minutes] [-e ber] [-m ber] [-f burst] [-w skew] [-o rate] [-l counts] [-c scenario] [-x ppm] [-h hours] [-r count] [-i counts]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (i < argc)
+    {   fprintf(stderr, "Usage: %s [-t seconds] [-p pth] [-s seed] [-b count] [-d minutes] [-e ber] [-m ber] [-f burst] [-w skew] [-o rate] [-l counts] [-c scenario] [-x ppm] [-h hours] [-r count] [-i counts]\n", argv[0]);
+        return 1;
+    }
+    if (benchmark)
+    {   benchmarkDisplay(benchmark);
+        return 0;
+    }
+    if (minutes)
+    {   benchDCF77(minutes);
+        return 0;
+    }
+    if (profile)
+    {
+#ifdef OSPROFILE
+        benchmarkProfile(profile);
+#else
+        printf("Profiler:          not built, use -DOSPROFILE\n");
+#endif
+        return 0;
+    }
+    if (ber >= 0.0)
+    {   benchSyncDCF77(ber);
+        return 0;
+    }
+    if (matchBer >= 0.0)
+    {   benchMatchDCF77(matchBer);
+        return 0;
+    }
+    if (burst >= 0)
+    {   benchBurstDCF77(burst);
+        return 0;
+    }
+    if (skewBench)
+    {   benchSkewDCF77(skew);
+        return 0;
+    }
+    if (spikeRate >= 0.0)
+    {   benchOversampleDCF77(spikeRate);
+        return 0;
+    }
+
+#ifdef DCF77CAPTURE
+    halPT1Source = readPortSim;                 // The simulated DCF77 signal drives port T.1
+#endif
+    halEndCycles = (unsigned long long) (seconds * HALBUSCLOCK);
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+    firmwareMain();                             // Never returns, see hostExit()
+    return 0;
+}
@@ -5,10 +5,29 @@
     Hochschule Esslingen
 
     Author:   W.Zimmermann, Sept 08, 2020
+
+    writeLine() does not wait for the display. The characters are put into the
+    ring buffer lcdQueue and written by the interrupt service routine isrECT5 of
+    ECT channel 5, one character per interrupt, with the display's processing
+    time in between. waitLCD() waits, until all characters have been written.
+    The ECT must be running, i.e. initTicker() must have been called before.
+    writeLine() and waitLCD() may wait for isrECT5, i.e. they must be called in
+    task context with interrupts enabled, see halCheckInterrupts().
+
+    lcdShadow holds the display content. writeLine() only queues the characters,
+    which differ from the shadow buffer, plus a cursor address command, if the
+    display's cursor is not already at the right position. lcdBusWrites and
+    lcdBusWritesAvoided count the bus writes done and saved.
+
+    All waiting is timed by TCNT (delayTicker), i.e. independent of the CPU clock.
+    With compiler flag LCDBUSYFLAG the display's busy flag is read back instead,
+    once the display accepts it, i.e. each write waits exactly as long as needed.
+    On the Dragon12 board this requires R/W of the display connected to port K.7.
 */
 
-#include <mc9s12dp256.h>                   
+#include "hal.h"
 #include "lcd.h"
+#include "ticker.h"
 
 #ifndef _HCS12_SERIALMON 
   #ifndef SIMULATOR
@@ -17,26 +36,52 @@
 #endif
 
 //***** LCD Display ***********************************************************
-/* Magic delay constants, based on 24MHz CPU clock */
+/* Delay constants in timer counts (5.33us), see delayTicker() */
 #define ENBIT       (0x02)
-#define DELAY40US   (200L)
-#define DELAY100US  (5000L)
-#define DELAY4_1MS  (22000L)
-#define DELAY4_10MS (220000L)
+#define RWBIT       (0x80)      // Dragon12 board: R/W on port K.7, only used with LCDBUSYFLAG
+#define DELAY40US   (8)
+#define DELAY100US  (19)
+#define DELAY1_6MS  (300)
+#define DELAY4_1MS  (769)
+#define DELAY4_10MS (1875)
 #define LCDWIDTH    (16)
 
 #define LCDDATA PORTK
 
-////////////////////////////////////////////////////////////////////////////////
-//! Delay routine (uses busy wait)
-void Delay(unsigned long constant)
-{   volatile unsigned long counter;
-    for (counter = constant; counter > 0; counter--);
+/* Output queue, timer counts at 187.5 kHz */
+#define TIMER_CH5   (0x20)      // Bit position for ECT channel 5
+#define LCDWAIT     (DELAY40US) // 42.7us after a character or command
+#define LCDWAITLONG (DELAY1_6MS)// 1.6ms after clear display and return home
+#define LCDPOLL     (2)         // 10.7us between busy flag reads (LCDBUSYFLAG)
+#define LCDQUEUESIZE (64)       // Must be a power of 2
+#define LCDRS       (0x100)     // Queue entry flag: rs=1, i.e. data
+
+static unsigned int lcdQueue[LCDQUEUESIZE];
+static volatile unsigned char lcdHead = 0;     // Next free entry, written by writeLine()
+static volatile unsigned char lcdTail = 0;     // Next entry to output, written by isrECT5
+static volatile unsigned char lcdBusy = 0;     // isrECT5 is active
+
+/* Shadow buffer */
+static char lcdShadow[2][LCDWIDTH];             // Display content
+static unsigned char lcdCursor;                 // Cursor address command after the last queued character
+unsigned long lcdBusWrites = 0;                 // Commands and characters written by writeLine()
+unsigned long lcdBusWritesAvoided = 0;          // ... and not written, because unchanged
+
+//! Shadow buffer after clear display, i.e. all blanks, cursor at top left
+static void initShadow(void)
+{   unsigned char i;
+
+    for (i = 0; i < LCDWIDTH; i++)
+    {   lcdShadow[0][i] = ' ';
+        lcdShadow[1][i] = ' ';
+    }
+    lcdCursor = 0x80;
 }
 
+////////////////////////////////////////////////////////////////////////////////
 //! Fixed 10ms delay
 void delay_10ms(void)
-{   Delay(DELAY4_10MS);
+{   delayTicker(DELAY4_10MS);
 }
 
 
@@ -44,31 +89,74 @@ void delay_10ms(void)
 #ifdef SIMULATOR
 // LCD functions for the Codewarrior HCS12 simulator
 
-#define LCDCTRL PORTA
+#define LCDCTRL PORTA		// Bit 0: RS, bit 1: R/W, bit 2: E
 
 void SLcdWriteCmd(unsigned char cmd)
 {   LCDCTRL = 0b00000100;
+    halLcdBus();
     LCDDATA = cmd;
     LCDCTRL = 0b00000000;
+    halLcdBus();
 }
 
 void SLcdWriteDat(unsigned char data)
 {   LCDCTRL = 0b00000101;
+    halLcdBus();
     LCDDATA = data;
     LCDCTRL = 0b00000001;
+    halLcdBus();
+}
+
+#ifdef LCDBUSYFLAG
+//! Read the busy flag, returns not 0, if the display is still busy
+static unsigned char SLcdBusy(void)
+{   unsigned char busy;
+
+    DDRK = 0x00;			//Data port as input
+    LCDCTRL = 0b00000010;		//R/W=1, RS=0
+    halLcdBus();
+    LCDCTRL = 0b00000110;		//E=1, display outputs busy flag and address
+    halLcdBus();
+    busy = LCDDATA & 0x80;
+    LCDCTRL = 0b00000010;
+    halLcdBus();
+    LCDCTRL = 0b00000000;
+    DDRK = 0xFF;
+    return busy;
+}
+#endif
+
+#define SLcdPutCmd(cmd)    SLcdWriteCmd(cmd)    // Waiting is done by the caller
+#define SLcdPutDat(data)   SLcdWriteDat(data)
+
+//! Write a command during initialization and wait, until it is processed
+static void SLcdInitCmd(unsigned char cmd)
+{   SLcdWriteCmd(cmd);
+#ifdef LCDBUSYFLAG
+    while (SLcdBusy())
+    {   halSpin();			//Host build only: advance virtual time
+    }
+#else
+    delayTicker(cmd < 0x04 ? DELAY1_6MS : DELAY40US);
+#endif
 }
 
 void initLCD(void)
 {   DDRA = 0xFF;
+    DDRK = 0xFF;
 
+    SLcdWriteCmd(0x30);			//Busy flag cannot be read before function set
+    delayTicker(DELAY4_1MS);
     SLcdWriteCmd(0x30);
+    delayTicker(DELAY100US);
     SLcdWriteCmd(0x30);
-    SLcdWriteCmd(0x30);
+    delayTicker(DELAY40US);
     
-    SLcdWriteCmd(0x38);
-    SLcdWriteCmd(0x0C);	// 0x0E ???
-    SLcdWriteCmd(0x01);
-    SLcdWriteCmd(0x06);
+    SLcdInitCmd(0x38);
+    SLcdInitCmd(0x0C);	// 0x0E ???
+    SLcdInitCmd(0x01);
+    SLcdInitCmd(0x06);
+    initShadow();
 }
 ////////////////////////////////////////////////////////////////////////////////
 #else	// #ifdef _HCS12_SERIALMON  
@@ -76,6 +164,9 @@ void initLCD(void)
 
 #define SLcdWriteCmd(cmd)  LcdWrite4(cmd, 0)
 #define SLcdWriteDat(data) LcdWrite4(data,1)
+#define SLcdPutCmd(cmd)    LcdPut4(cmd, 0)
+#define SLcdPutDat(data)   LcdPut4(data,1)
+#define SLcdBusy()         LcdBusy4()
 
 /*
  * Write LCD module in 8-bit mode
@@ -93,20 +184,20 @@ static void LcdWrite8(unsigned char data)
     LCDDATA = temp;                     //Do write with EN=0 */
     LCDDATA = temp | ENBIT;             //         with EN=1 pulse write enable
     LCDDATA = temp;                     //         with EN=0
-    Delay(DELAY40US);                   //Pause for display to complete processing
+    delayTicker(DELAY40US);             //Pause for display to complete processing
 }
 
 /*
- * Write LCD module in 4-bit mode
+ * Write LCD module in 4-bit mode without waiting
  * Inputs:
  *  data: to be written, 8 bits are significant
  *  rs: register select, only bit 0 is significant
  * Does two consecutive writes, high nibble, then low
  * Handles the shifting into place and the EN pulsing
- * This is can be used at any time (init and display)
+ * Used by the output queue, which waits by timer interrupt
  *
 */
-static void LcdWrite4(unsigned char data, unsigned char rs)
+static void LcdPut4(unsigned char data, unsigned char rs)
 {   unsigned char hi, lo;
 
     hi = ((data & 0xf0) >> 2) | (rs & 0x01);    //Split byte into 2 nibbles
@@ -118,7 +209,42 @@ static void LcdWrite4(unsigned char data, unsigned char rs)
     LCDDATA = lo;                        //Do write lower nibble with EN=0
     LCDDATA = lo | ENBIT;                //                      with EN=1 pulse write enable
     LCDDATA = lo;                        //                      with EN=0
-    Delay(DELAY40US);                   //Pause for display to complete processing
+}
+
+#ifdef LCDBUSYFLAG
+/*
+ * Read the busy flag in 4-bit mode, returns not 0, if the display is still busy
+ * Needs R/W of the display on port K.7, only used with LCDBUSYFLAG
+ *
+*/
+static unsigned char LcdBusy4(void)
+{   unsigned char busy;
+
+    DDRK = 0xFF & ~0x3C;                //D4..D7 on port K.2..5 as inputs
+    LCDDATA = RWBIT;                    //Read upper nibble with EN=0
+    LCDDATA = RWBIT | ENBIT;            //                  with EN=1, D7 is the busy flag
+    busy = LCDDATA & 0x20;
+    LCDDATA = RWBIT;                    //                  with EN=0
+    LCDDATA = RWBIT | ENBIT;            //Read lower nibble, ignored
+    LCDDATA = RWBIT;
+    LCDDATA = 0;
+    DDRK = 0xFF;
+    return busy;
+}
+#endif
+
+/*
+ * Write LCD module in 4-bit mode and wait
+ * This is only used during the init sequence
+ *
+*/
+static void LcdWrite4(unsigned char data, unsigned char rs)
+{   LcdPut4(data, rs);
+#ifdef LCDBUSYFLAG
+    while (LcdBusy4());                 //Wait until the display has processed the data
+#else
+    delayTicker((data < 0x04 && !rs) ? DELAY1_6MS : DELAY40US); //Pause for display to complete processing
+#endif
 }
 
 //! Initialize LCD module, must be called before using LCD display
@@ -126,9 +252,9 @@ void initLCD(void)
 {   DDRK = 0xFF;                        //Set port K as output
 
     LcdWrite8(0x30);                    //Tell LCD once
-    Delay(DELAY4_1MS);
+    delayTicker(DELAY4_1MS);
     LcdWrite8(0x30);                    //Tell LCD twice
-    Delay(DELAY100US);
+    delayTicker(DELAY100US);
     LcdWrite8(0x30);                    //Tell LCD thrice
     LcdWrite8(0x20);                    //Last write in 8-bit mode sets bus to 4 bit mode
                                         //Now we are in 4 bit mode, write upper/lower nibble
@@ -137,12 +263,70 @@ void initLCD(void)
     SLcdWriteCmd(0x0C); 		//display on, cursor off, blink off									*/
     SLcdWriteCmd(0x01); 		//display clear																			*/
     SLcdWriteCmd(0x06); 		//cursor auto-increment, disable display shift
+    initShadow();
 }
 #endif
 ////////////////////////////////////////////////////////////////////////////////
 
+//! Queue a command or (with LCDRS) a character, start the output, if idle
+/* Task context only, i.e. call with interrupts enabled: if the queue is full,
+ * it waits for isrECT5, and it enables the interrupts again at the end.
+ */
+static void putLCD(unsigned int entry)
+{   halCheckInterrupts();		//Host build only: abort, if called with interrupts disabled
+    while ((unsigned char) (lcdHead - lcdTail) >= LCDQUEUESIZE)
+    {   halIdle();			//Queue full, wait for isrECT5
+    }
+    lcdQueue[lcdHead & (LCDQUEUESIZE - 1)] = entry;
+    lcdHead++;
+
+    DisableInterrupts;
+    if (!lcdBusy)			//Start output with the next interrupt
+    {   lcdBusy = 1;
+        TIOS  = TIOS | TIMER_CH5;
+        TC5   = TCNT + LCDWAIT;
+        TFLG1 = TIMER_CH5;
+        TIE   = TIE | TIMER_CH5;
+    }
+    EnableInterrupts;
+}
+
+//! Interrupt service routine of ECT channel 5, outputs the next queue entry
+void HAL_ISR(13) isrECT5(void)
+{   unsigned int entry;
+
+    TFLG1 = TIMER_CH5;			//Clear the interrupt flag
+    if (lcdHead == lcdTail)		//Queue empty, stop
+    {   TIE = TIE & ~TIMER_CH5;
+        lcdBusy = 0;
+        return;
+    }
+
+#ifdef LCDBUSYFLAG
+    if (SLcdBusy())			//Display still busy, try again
+    {   TC5 = TCNT + LCDPOLL;
+        return;
+    }
+#endif
+
+    entry = lcdQueue[lcdTail & (LCDQUEUESIZE - 1)];
+    lcdTail++;
+    if (entry & LCDRS)
+    {   SLcdPutDat((unsigned char) entry);
+    } else
+    {   SLcdPutCmd((unsigned char) entry);
+    }
+
+#ifdef LCDBUSYFLAG
+    TC5 = TCNT + LCDPOLL;
+#else
+    TC5 = TCNT + (((entry & LCDRS) || (unsigned char) entry >= 0x04) ? LCDWAIT : LCDWAITLONG);
+#endif
+}
+
 //! Write a line of max. 16 ASCII characters to the LCD display
-/* Write a line to the LCD.
+/* Write a line to the LCD, does not wait for the display, see waitLCD().
+ * Task context only, with interrupts enabled, see putLCD().
  * Inputs:
  *   string: is a pointer to a null terminated array of char to be sent.
  *   line: determines which line to display (0=top line, 1=bottom line).
@@ -156,25 +340,39 @@ void initLCD(void)
 void writeLine(char* string, unsigned char line)
 {   char currentChar;
     char endOfLine;
+    char c;
+    unsigned char address, writes = 0;
 
-    if (line == 1)                      //Set address in LCD module
-        SLcdWriteCmd(0xC0);		//-- bottom line
-//	LcdWrite4(0xC0, 0);		//-- bottom line
-    else
-  	SLcdWriteCmd(0x80);  		//-- top line
-//	LcdWrite4(0x80, 0);		//-- top line
+    if (line != 1)			//Shadow buffer row: bottom line or top line
+        line = 0;
 
-     endOfLine = 0;			//Send 16 characters to LDC display
+     endOfLine = 0;			//Send changed characters to LDC display
      for (currentChar = 0; currentChar < LCDWIDTH; ++currentChar)
-     {  if (string[currentChar] == 0)
+     {  if (string[(int) currentChar] == 0)
         {   endOfLine = 1;
 	}
-	if (endOfLine == 0)
-	{   SLcdWriteDat(string[currentChar]); // rs=1 means data
-//	    LcdWrite4(string[currentChar], 1); // rs=1 means data
-	} else
-	{   SLcdWriteDat(' ');
-//	    LcdWrite4(' ', 1);
+	c = endOfLine ? ' ' : string[(int) currentChar];
+	if (lcdShadow[line][(int) currentChar] != c)
+	{   address = (line ? 0xC0 : 0x80) + currentChar;
+	    if (lcdCursor != address)	//Set address in LCD module
+	    {   putLCD(address);
+	        writes++;
+	    }
+	    putLCD(LCDRS | (unsigned char) c); // rs=1 means data
+	    writes++;
+	    lcdShadow[line][(int) currentChar] = c;
+	    lcdCursor = address + 1;	//Cursor auto-increment
 	}
      }
+
+     lcdBusWrites = lcdBusWrites + writes;
+     lcdBusWritesAvoided = lcdBusWritesAvoided + (LCDWIDTH + 1 - writes);
+}
+
+//! Wait until all queued characters have been written to the display
+void waitLCD(void)
+{   halCheckInterrupts();		//Host build only: abort, if called with interrupts disabled
+    while (lcdBusy)
+    {   halIdle();			//Host build only: advance virtual time
+    }
 }
\ No newline at end of file
@@ -7,7 +7,12 @@
     Author:   W.Zimmermann, Sept 08, 2020
 */
 
-// Public functions, for details see lcd.asm
+// Public functions, for details see lcd.c
 void initLCD(void);
 void writeLine(char* text, unsigned char zeilennummer);
+void waitLCD(void);
+
+// Bus write counters, for details see lcd.c
+extern unsigned long lcdBusWrites;
+extern unsigned long lcdBusWritesAvoided;
 void delay_10ms(void);
\ No newline at end of file
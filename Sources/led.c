@@ -7,7 +7,7 @@
     Author:   W.Zimmermann, Sept 08, 2020
 */
 
-#include <mc9s12dp256.h>                        // CPU specific defines
+#include "hal.h"                                // CPU specific defines
 #include "led.h"
 
 // Initialize LEDs (called once)
@@ -23,19 +23,25 @@ void initLED(void)
 }
 
 // Toggle LEDs specified by binary mask, e.g. 0x81 toggles LED7 and LED0
+#ifndef HOST
 #pragma INLINE
+#endif
 void toggleLED(unsigned char mask)
 {   PORTB = PORTB ^ mask;
 }
 
 // Set LEDs specified by binary mask, e.g. 0x81 set LED7 and LED0
+#ifndef HOST
 #pragma INLINE
+#endif
 void setLED(unsigned char mask)
 {   PORTB = PORTB | mask;
 }
 
 // Clear LEDs specified by binary mask, e.g. 0x81 clears LED7 and LED0
+#ifndef HOST
 #pragma INLINE
+#endif
 void clrLED(unsigned char mask)
 {   PORTB = PORTB & (~mask);
 }
@@ -9,10 +9,11 @@
                         Tolgahan Kandemir, 761469
 */
 
-#include <hidef.h>                              // Common defines
-#include <mc9s12dp256.h>                        // CPU specific defines
+#include "hal.h"                                // Common and CPU specific defines
 
+#ifndef HOST                                    // CodeWarrior only
 #pragma LINK_INFO DERIVATIVE "mc9s12dp256b"
+#endif
 
 #include "led.h"
 #include "lcd.h"
@@ -24,18 +25,22 @@
 
 osTCB osTaskList[OSNUMTASKS] = 			// List of all tasks and associated trigger events
 {
-    processEventsClock,  (int*) &clockEvent,   	// --- Clock task
+    {   processEventsClock,  NULL, &clockQueue },	// --- Clock task
 	
-    processEventsDCF77,  (int*) &dcf77Event,   	// --- DCF77 task
+    {   processEventsDCF77,  NULL, &dcf77Queue },	// --- DCF77 task
     
-    displayDateTimeClock,(int*) &displayEvent, 	// --- Date / Time display task
+    {   displayDateTimeClock,(int*) &displayEvent, NULL },	// --- Date / Time display task
 
-    NULL, NULL 	      				// --- Must always be the last entry
+    {   NULL, NULL, NULL } 	      		// --- Must always be the last entry
 };
 
 
 // ****************************************************************************
+#ifdef HOST
+void firmwareMain(void)                         // Host build: main() is the simulation driver in hostMain.c
+#else
 void main(void)
+#endif
 {   EnableInterrupts;                           // Allow interrupts
 
 //  Initialize all modules
@@ -1,27 +1,245 @@
 /*  Operating System (OS) module
 
     Computerarchitektur / Computer Architecture
-    (C) 2020/2021 J. Friedrich, W. Zimmermann 
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
     Hochschule Esslingen
 
     Author:   W.Zimmermann, Sept 08, 2020
+
+    Event driven scheduling: Event producers set the task's event and then its bit
+    in osReadyMask by calling osSetReady(). The scheduler only calls tasks with a
+    set bit. If no task is ready, the CPU sleeps (WAI) until the next interrupt.
+
+    Event queues: Producers of frequent events, e.g. interrupt service routines,
+    put their events into an osQueue with osPut() instead of overwriting a single
+    event variable. Each queue is a ring buffer with one producer and one consumer,
+    the scheduler. The producer only writes osHead, the scheduler only osTail, so
+    no interrupts need to be disabled. Every event carries a time stamp, the task
+    finds it in osEventTime. Optionally the producer adds a data byte, e.g. state
+    of the ISR, which the task must not read later, see osPutData() and osEventData.
+    A full queue drops the new event and counts it in
+    osOverflows, osBacklog holds the worst case number of queued events.
+
+    Run time profiles (compiler flag OSPROFILE): Every task call and the interrupt
+    service routines are timed with TCNT, see osProfileStart(). The profiles keep the
+    minimum, maximum, mean and a log2 histogram, see osProfileRead(). Without the flag
+    the macros are empty, i.e. there is no code at all.
+
+    Compiler flags:
+    OSBUSYPOLL  Use the original busy polling loop over all task events instead
+    OSSTATS     Measure the idle fraction with time stamps (see tickerTime()) and the
+                dispatch latency with TCNT, see osStats
+    OSPROFILE   Measure the run time of the tasks and interrupt service routines
 */
 
+#include "hal.h"
 #include "os.h"
+#ifdef OSSTATS
+#include "ticker.h"
+#endif
+
+volatile unsigned char osReadyMask = 0;
+unsigned long osEventTime = 0;
+unsigned char osEventData = 0;
+
+#ifdef OSSTATS
+osStatistics osStats;
+volatile unsigned short osReadyTime[OSNUMTASKS];
+#endif
+
+#ifdef OSPROFILE
+static osProfile osProfiles[OSPROFILES];
+volatile unsigned short osProfileStarts[OSPROFILES];	// TCNT at osProfileStart()
+#endif
+
+// Public interface function: osPutData ... Put an event into a queue, called by the single producer
+// Parameter:   queue   Queue of the consumer task
+//              event   Event, not 0
+//              data    Data byte of the event, the task finds it in osEventData, osPut() sets 0
+//              time    Time stamp of the event, e.g. tickerTime()
+// Returns:     1, if queued, 0, if the queue was full and the event is lost
+// The producer calls osSetReady() afterwards. Safe in task and ISR context, but
+// all events of a queue must be put in the same context.
+int osPutData(osQueue *queue, unsigned char event, unsigned char data, unsigned long time)
+{   unsigned char head = queue->osHead;
+    unsigned char count = (unsigned char) (head - queue->osTail);
+
+    if (count >= OSQUEUESIZE)
+    {   queue->osOverflows++;
+        return 0;
+    }
+    queue->osEvents[head & (OSQUEUESIZE - 1)] = event;
+    queue->osTimes[head & (OSQUEUESIZE - 1)] = time;
+    queue->osData[head & (OSQUEUESIZE - 1)] = data;
+    queue->osHead = (unsigned char) (head + 1);	// Publish the event after it is complete
+    if (count >= queue->osBacklog)
+        queue->osBacklog = (unsigned char) (count + 1);
+    return 1;
+}
+
+#ifdef OSPROFILE
+// Public interface function: osProfileAdd ... Add the run time since osProfileStart() to a profile
+// Parameter:   slot    Task number or OSPROFILETICKER, ...
+// Called by osProfileEnd(). Each slot is updated in one context only, either by the
+// scheduler or by its ISR, so no interrupts need to be disabled.
+void osProfileAdd(unsigned char slot)
+{   osProfile *profile = &osProfiles[slot];
+    unsigned short time = TCNT - osProfileStarts[slot];
+    unsigned short rest = time;
+    unsigned char bucket = 0;
+
+    while (rest > 1)			// log2, at most 15 shifts
+    {   rest = rest >> 1;
+        bucket++;
+    }
+    if (profile->count == 0 || time < profile->min)
+        profile->min = time;
+    if (time > profile->max)
+        profile->max = time;
+    profile->count++;
+    profile->sum += time;
+    profile->histogram[bucket]++;
+}
+
+// Public interface function: osProfileRead ... Copy a profile, e.g. for a display or a debugger
+// Parameter:   slot    Task number or OSPROFILETICKER, ...
+//              profile Copy of the profile, consistent also for the ISR slots
+void osProfileRead(unsigned char slot, osProfile *profile)
+{   DisableInterrupts;
+    *profile = osProfiles[slot];
+    EnableInterrupts;
+}
+
+// Public interface function: osProfileReset ... Clear all profiles, e.g. after the start up
+void osProfileReset(void)
+{   unsigned char i, k;
+
+    DisableInterrupts;
+    for (i = 0; i < OSPROFILES; i++)
+    {   osProfiles[i].count = 0;
+        osProfiles[i].sum = 0;
+        osProfiles[i].min = 0;
+        osProfiles[i].max = 0;
+        for (k = 0; k < OSPROFILEBUCKETS; k++)
+            osProfiles[i].histogram[k] = 0;
+    }
+    EnableInterrupts;
+}
+#endif
+
+#ifdef OSSTATS
+// Internal function: osLatency ... Update the dispatch statistics of task i
+static void osLatency(int i)
+{   unsigned short latency = TCNT - osReadyTime[i];
+    osStats.dispatches++;
+    osStats.latencySum += latency;
+    if (latency > osStats.latencyMax)
+        osStats.latencyMax = latency;
+}
+#else
+#define osLatency(i)	((void) (i))	// Uses i, so it is no unused parameter
+#endif
+
+// Internal function: osDispatchQueue ... call task once for each queued event
+// Only the events queued at the start are taken, later ones set the ready bit again.
+// Returns 1, if the task was called
+static int osDispatchQueue(osTCB *task, int i)
+{   osQueue *queue = task->osPQueue;
+    unsigned char tail = queue->osTail;
+    unsigned char count = (unsigned char) (queue->osHead - tail);
+    unsigned char event;
+
+    if (count == 0)
+        return 0;
+    osLatency(i);
+    for ( ; count; count--)
+    {   event = queue->osEvents[tail & (OSQUEUESIZE - 1)];
+        osEventTime = queue->osTimes[tail & (OSQUEUESIZE - 1)];
+        osEventData = queue->osData[tail & (OSQUEUESIZE - 1)];
+        queue->osTail = ++tail;			// -- Free the slot, the event is copied
+        osProfileStart(i);
+        if (task->osTaskFunction)
+        {   task->osTaskFunction(event);
+        }
+        halTask();				// Host build only: virtual run time of the task
+        osProfileEnd(i);
+    }
+    return 1;
+}
+
+// Internal function: osDispatch ... call task, if its event was triggered, and reset the event
+// Returns 1, if the task was called
+static int osDispatch(osTCB *task, int i)
+{   if (task->osPQueue)				// -- Queued events
+    {   return osDispatchQueue(task, i);
+    }
+    if (task->osPEvent && *task->osPEvent)	// -- Call task, if event was triggered
+    {   osLatency(i);
+        osProfileStart(i);
+        if (task->osTaskFunction)
+        {   task->osTaskFunction((osEvent) *task->osPEvent);
+        }
+        *task->osPEvent = 0;			// -- Reset event
+        halTask();				// Host build only: virtual run time of the task
+        osProfileEnd(i);
+        return 1;
+    }
+    (void) i;
+    return 0;
+}
 
 void initOS(osTCB osTaskList[])
 {   int i;
+    unsigned char ready;
+#ifndef OSBUSYPOLL
+    unsigned char pending;		// Ready tasks not called yet, ready is kept for the statistics
+#endif
+#ifdef OSSTATS
+    unsigned long now, last = tickerTime(), idleStart;
+#endif
 
 //  Operating system scheduling loop
-    for(;;)					
-    {   for (i=0; i<OSNUMTASKS; i++)		// Loop through all tasks in task list
-        {   
-            if (osTaskList[i].osPEvent && *osTaskList[i].osPEvent)        // -- Call task, if event was triggered
-            {   if (osTaskList[i].osTaskFunction)
-                {   osTaskList[i].osTaskFunction(*osTaskList[i].osPEvent);
-                }
-                *osTaskList[i].osPEvent = 0;	// -- Reset event		         
+    for(;;)
+    {
+#ifdef OSSTATS
+        osStats.passes++;
+        idleStart = last;
+#endif
+
+#ifdef OSBUSYPOLL
+        ready = 0;
+        for (i=0; i<OSNUMTASKS; i++)		// Loop through all tasks in task list
+        {   ready |= osDispatch(&osTaskList[i], i);
+        }
+        DisableInterrupts;
+        osReadyMask = 0;			// Only used for the latency statistics
+        EnableInterrupts;
+        halIdle();				// Host build only: advance virtual time
+#else
+        DisableInterrupts;
+        ready = osReadyMask;
+        if (ready == 0)				// Nothing to do, sleep until the next interrupt
+        {
+#ifdef OSSTATS
+            idleStart = tickerTime();
+#endif
+            halWait();				// Enables interrupts again
+        } else
+        {   osReadyMask = 0;
+            EnableInterrupts;
+            for (i=0, pending=ready; pending; i++, pending >>= 1)	// Call the ready tasks only
+            {   if (pending & 0x01)
+                    (void) osDispatch(&osTaskList[i], i);
             }
         }
+#endif
+
+#ifdef OSSTATS
+        now = tickerTime();			// Also correct for loop iterations longer than a TCNT wrap
+        osStats.totalTime += now - last;
+        if (!ready)
+            osStats.idleTime += now - idleStart;
+        last = now;
+#endif
     }
 }
@@ -1,17 +1,106 @@
 /*  Header for Operating System module
 
     Computerarchitektur / Computer Architecture
-    (C) 2020/2021 J. Friedrich, W. Zimmermann 
+    (C) 2020/2021 J. Friedrich, W. Zimmermann
     Hochschule Esslingen
 
     Author:   W.Zimmermann, Sept 08, 2020
 */
 
+#ifndef OS_H
+#define OS_H
+
+#include "hal.h"
+
 #define OSNUMTASKS 8	 		// Number of operating system tasks
+#define OSQUEUESIZE 8			// Events per event queue, power of 2
+
+// Task numbers, i.e. position in the task list in main.c
+#define OSTASKCLOCK	0		// processEventsClock
+#define OSTASKDCF77	1		// processEventsDCF77
+#define OSTASKDISPLAY	2		// displayDateTimeClock
+
+typedef unsigned char osEvent;		// Event passed to a task, the tasks compare it with their own event types
+
+typedef struct				// Data type for event queues, see osPut()
+{   unsigned char osEvents[OSQUEUESIZE];	// Events in the order of arrival
+    unsigned long osTimes[OSQUEUESIZE];	// Time stamps of the events, set by the producer
+    unsigned char osData[OSQUEUESIZE];	// Data byte of the events, see osPutData()
+    volatile unsigned char osHead;	// Written by the producer only
+    volatile unsigned char osTail;	// Written by the consumer (scheduler) only
+    unsigned long osOverflows;		// Events lost, because the queue was full
+    unsigned char osBacklog;		// Maximum number of queued events so far
+} osQueue;
 
 typedef struct 				// Data type for tasks
-{   void (*osTaskFunction)(enum event);	// Function pointer to task
+{   void (*osTaskFunction)(osEvent);	// Function pointer to task
     int *osPEvent;			// Event, which trigger task execution
+    osQueue *osPQueue;			// ... or queue of events, which trigger task execution
 } osTCB;
 
-void initOS(osTCB osTaskList[]);	// Function to start the operating system, does never return
\ No newline at end of file
+// Time stamp of the queued event passed to the running task, see osPut()
+extern unsigned long osEventTime;
+
+// Data byte of the queued event passed to the running task, see osPutData()
+extern unsigned char osEventData;
+
+// Ready mask, bit i set means task i has a pending event
+extern volatile unsigned char osReadyMask;
+
+#ifdef OSSTATS
+typedef struct				// Scheduler statistics, times in TCNT counts
+{   unsigned long passes;		// Scheduler loop iterations
+    unsigned long dispatches;		// Task calls
+    unsigned long idleTime;		// Time spent waiting for events
+    unsigned long totalTime;		// Total time spent in the scheduler loop
+    unsigned long latencySum;		// Sum of dispatch latencies (event set -> task called)
+    unsigned int  latencyMax;		// Maximum dispatch latency
+} osStatistics;
+
+extern osStatistics osStats;
+extern volatile unsigned short osReadyTime[OSNUMTASKS];
+
+#define osStampReady(task) do { if (!(osReadyMask & (1 << (task)))) osReadyTime[task] = TCNT; } while (0)
+#else
+#define osStampReady(task) do { } while (0)
+#endif
+
+#ifdef OSPROFILE
+// Profiles of the tasks 0..OSNUMTASKS-1 and of the interrupt service routines
+#define OSPROFILETICKER	(OSNUMTASKS + 0)	// isrECT4, including tick10ms()
+#define OSPROFILECAPTURE (OSNUMTASKS + 1)	// isrECT1, DCF77 input capture
+#define OSPROFILESAMPLE	(OSNUMTASKS + 2)	// isrECT6, DCF77 oversampling
+#define OSPROFILES	(OSNUMTASKS + 3)
+#define OSPROFILEBUCKETS 16			// Bucket k counts run times 2^k..2^(k+1)-1, k = 0 also 0
+
+typedef struct				// Data type for run time profiles, times in TCNT counts
+{   unsigned long count;		// Measured runs
+    unsigned long sum;			// Sum of the run times, for the mean
+    unsigned short min, max;		// Shortest and longest run time
+    unsigned long histogram[OSPROFILEBUCKETS];	// Runs per log2 bucket of the run time
+} osProfile;
+
+extern volatile unsigned short osProfileStarts[OSPROFILES];
+
+// Measure the run time of a task or an ISR between osProfileStart() and osProfileEnd().
+// Task times include the interrupts meanwhile. ISRs do not nest, i.e. one start per slot.
+#define osProfileStart(slot) osProfileStarts[slot] = TCNT
+#define osProfileEnd(slot) osProfileAdd(slot)
+
+void osProfileAdd(unsigned char slot);		// Add the run time since osProfileStart(), task and ISR context
+void osProfileRead(unsigned char slot, osProfile *profile);	// Copy a profile, task context
+void osProfileReset(void);			// Clear all profiles, task context
+#else
+#define osProfileStart(slot)
+#define osProfileEnd(slot)
+#endif
+
+// Mark a task as ready, called by the event producers after setting the event.
+// Constant task numbers compile to a single BSET, i.e. safe in task and ISR context.
+#define osSetReady(task) do { osStampReady(task); osReadyMask |= (1 << (task)); } while (0)
+
+void initOS(osTCB osTaskList[]);	// Function to start the operating system, does never return
+int osPutData(osQueue *queue, unsigned char event, unsigned char data, unsigned long time);	// Queue an event, task and ISR context
+#define osPut(queue, event, time) osPutData(queue, event, 0, time)	// Queue an event without data
+
+#endif
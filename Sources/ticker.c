@@ -14,11 +14,48 @@
                                 void tick10ms(void)
     will be called. This function must end before the next timer interrupt event, i.e.
     the callbacks run time must be less than 10ms!
+
+    Time stamps:
+    tickerTime() and tickerTimestamp() count timer counts (5.33us) since initTicker(),
+    built from the 10ms ticks and TCNT. They are the time base of all modules: event
+    time stamps, pulse widths, profiling. They wrap after about 6.3 hours, so only
+    differences are used, i.e. (unsigned long) (b - a) of stamps less than 6.3 hours apart.
+
+    Tickless mode (compiler flag TICKLESS):
+    The modules register their next deadline with tickerRequest(). TC4 is programmed
+    for the earliest deadline (at most MAXTICKS ahead, because TCNT has 16 bits only)
+    and tick10ms() is only called, when a deadline is reached. The callback uses
+    tickerNow() to find out how many 10ms ticks have elapsed.
+    Requests made in tick10ms(), i.e. in the ISR, take effect immediately. Requests
+    made in task context take effect with the next interrupt.
+
+    Trimmed ticker (compiler flag CLOCKDISCIPLINE):
+    The period of TC4 is TENMS plus a fraction of a timer count, set by tickerTrim()
+    in 1/65536 counts per tick, e.g. by the frequency locked loop in clock.c. The
+    fractions are accumulated in tickerPhase, TC4 gets the integer part, so a period
+    is TENMS-1, TENMS or TENMS+1 counts. The ticks and the time stamps count 10ms
+    of the true time instead of the crystal.
+
+    Aligned ticks:
+    tickerAlign() shifts the ticks by less than half a tick, so that a tick starts at
+    a given time stamp, e.g. a DCF77 second. The shift lengthens or shortens the period
+    after the next compare event, the time stamps stay continuous, see tickerSkew.
+
+    Overruns:
+    If the ISR starts late, e.g. because the last tick10ms() ran longer than 10ms, the
+    next compare events may already have passed. TC4 would then be programmed into the
+    past and the next compare match would only come after a full wrap of TCNT, i.e. the
+    ticks would lose about 350ms. The ISR compares TCNT against the compare event and
+    counts the passed ticks instead, see tickerCatchUp(). tickerOverruns and tickerMissed
+    count these events, tickerShed is set for TICKERSHEDTICKS ticks, when the ISR was late
+    or ran longer than TICKERBUDGET. Meanwhile the modules skip optional work, e.g. the
+    LEDs and the 1ms oversampling in dcf77.c.
  
 */ 
 
 #include "ticker.h"
-#include <mc9s12dp256.h>
+#include "hal.h"
+#include "os.h"                 // osProfileStart()
 
 
 // Defines
@@ -26,39 +63,270 @@
 #define TIMER_ON    0x80       	// tscr1 value to turn ECT on
 #define TIMER_CH4   0x10        // Bit position for channel 4
 #define TCTL1_CH4   0x03        // Mask corresponds to TCTL1 OM4, OL4
+#define MAXTICKS    34          // Longest TC4 period in ticks, 34*TENMS < 65536
+#define TICKERMARGIN 16         // Compare events closer than this to TCNT count as passed
+#define TICKERBUDGET (TENMS * 4 / 5)	// Longest run time of the ISR without shedding work
+#define TICKERSHEDTICKS 100     // Ticks to shed work after an overrun, 1s
 
 
 // External function
 void tick10ms(void);
 
+// Module variables
+static volatile unsigned long tickerTicks = 0;	// 10ms ticks at the last compare event
+static volatile unsigned short tickerBase = 0;	// TCNT value of the last compare event
+static volatile unsigned long tickerSkew = 0;	// Sum of the shifts, time stamp of tick 0
+static volatile int tickerShift = 0;		// Shift of the next period, see tickerAlign()
+static volatile int tickerShifted = 0;		// Shift of the running period
 
-// Public interface function: initLCD ... Initialize Ticker channel 4 (called once)
-void initTicker(void)
-{   TSCR1 = TIMER_ON; 		// Timer master ON switch
-    TIOS  = TIOS | TIMER_CH4;	// Set channel 4 in "output compare" mode
-    TIE   = TIE  | TIMER_CH4;   // Enable channel 4 interrupt; bit 4 corresponds to channel 4
+// Public variables, see ticker.h
+unsigned long tickerOverruns = 0;		// Late ISR calls, which missed compare events
+unsigned long tickerMissed = 0;			// Ticks caught up by these ISR calls
+volatile unsigned char tickerShed = 0;		// Ticks left to shed optional work, 0 = normal operation
 
-    // Set timer prescaler (bus clock : prescale factor)
+#ifdef TICKLESS
+static unsigned long  tickerDeadline[TICKERNUMCLIENTS];	// Absolute deadlines in ticks
+static unsigned char  tickerPeriod = 1;		// Ticks until the programmed compare event
+#endif
+#ifdef CLOCKDISCIPLINE
+static volatile long tickerTrimming = 0;	// Correction in 1/65536 counts per tick, see tickerTrim()
+static long tickerPhase = 0;			// Accumulated fraction, -0x8000..0x7FFF
+#endif
+
+#ifdef CLOCKDISCIPLINE
+// Internal function: tickerCorrection ... Timer counts to add to the next period, ISR context
+// Parameter:   ticks   Ticks of the next period
+static int tickerCorrection(unsigned char ticks)
+{   int counts = 0;
+
+    tickerPhase = tickerPhase + tickerTrimming * ticks;
+    while (tickerPhase >= 0x8000L)
+    {   tickerPhase = tickerPhase - 0x10000L;
+        counts++;
+    }
+    while (tickerPhase < -0x8000L)
+    {   tickerPhase = tickerPhase + 0x10000L;
+        counts--;
+    }
+    return counts;
+}
+#else
+#define tickerCorrection(ticks)	0
+#endif
+
+// Internal function: tickerCatchUp ... Skip the compare events, which passed before the ISR ran, ISR context
+// Call after tickerBase and tickerShifted are updated for the running period. The passed
+// ticks are counted, so tickerNow() and the time stamps stay correct, and tickerBase is
+// moved to the last passed compare event, so that TC4 can be programmed into the future.
+static void tickerCatchUp(void)
+{   unsigned short late;
+    unsigned int period;
+    unsigned char missed;
+
+    late = TCNT - tickerBase;
+    period = TENMS + tickerShifted;
+    if ((unsigned long) late + TICKERMARGIN < period)
+        return;			// In time, the next compare event is still ahead
+
+    missed = (unsigned char) (1 + ((unsigned long) late + TICKERMARGIN - period) / TENMS);
+    tickerTicks = tickerTicks + missed;
+    tickerSkew = tickerSkew + tickerShifted;
+    tickerBase = tickerBase + period + (unsigned short) (missed - 1) * TENMS + tickerCorrection(missed);
+    tickerShifted = 0;
+    tickerOverruns++;
+    tickerMissed = tickerMissed + missed;
+    tickerShed = TICKERSHEDTICKS;
+}
+
+// Internal function: tickerBudget ... Shed optional work, if the ISR ran too long, ISR context
+static void tickerBudget(void)
+{   if ((unsigned short) (TCNT - tickerBase) > TICKERBUDGET)
+        tickerShed = TICKERSHEDTICKS;
+}
+
+
+// Internal function: startTimer ... Set the prescaler and turn the ECT on
+static void startTimer(void)
+{   // Set timer prescaler (bus clock : prescale factor)
     // In our case: divide by 2^7 = 128. This gives a timer
     // driver frequency of 187500 Hz or 5.3333 us time interval
-#ifdef SIMULATOR
+#if defined(SIMULATOR) && !defined(HOST)
     TSCR2 = (TSCR2 & 0xF8) | 0x05;// Speedup clock for debugging in simulator
 #else
     TSCR2 = (TSCR2 & 0xF8) | 0x07;
 #endif
 
-    TC4 = TCNT + TENMS;		// First timer event
+    TSCR1 = TIMER_ON; 		// Timer master ON switch
+}
+
+// Public interface function: initTicker ... Initialize Ticker channel 4 (called once)
+void initTicker(void)
+{   startTimer();
+    TIOS  = TIOS | TIMER_CH4;	// Set channel 4 in "output compare" mode
+    TIE   = TIE  | TIMER_CH4;   // Enable channel 4 interrupt; bit 4 corresponds to channel 4
+
+    tickerBase = TCNT;
+    TC4 = tickerBase + TENMS;	// First timer event
     
     TCTL1 = TCTL1 & ~TCTL1_CH4; // Turn timer channel 4 on
 }
 
 
+// Public interface function: delayTicker ... Busy wait using TCNT
+// Parameter:   counts  Timer counts (5.33us), less than 32768
+// Starts the timer, if not running yet, i.e. can be used before initTicker(),
+// e.g. for the LCD initialization. Runs 4 times faster in the simulator build.
+void delayTicker(unsigned short counts)
+{   unsigned short start;
+
+    if (!(TSCR1 & TIMER_ON))
+        startTimer();
+
+    start = TCNT;
+    while ((unsigned short) (TCNT - start) < counts)
+    {   halSpin();		// Host build only: advance virtual time
+    }
+}
+
+// Public interface function: tickerNow ... Number of 10ms ticks since initTicker()
+// Counts ticks between interrupts by reading TCNT, i.e. also correct in tickless mode.
+// Can be called in task and ISR context.
+unsigned long tickerNow(void)
+{   unsigned long ticks, now;
+
+    do				// Retry, if the ISR updated the tick count meanwhile
+    {   ticks = tickerTicks;
+        now = ticks + (unsigned short) (TCNT - tickerBase) / TENMS;
+    } while (ticks != tickerTicks);
+    return now;
+}
+
+// Public interface function: tickerTimestamp ... Convert a TCNT value into a 32 bit time stamp
+// Parameter:   tcnt    TCNT value captured in the past, e.g. input capture register
+// Returns:     Timer counts (5.33us) since initTicker(), wraps after about 6.3 hours
+// Can be called in task and ISR context.
+unsigned long tickerTimestamp(unsigned short tcnt)
+{   unsigned long ticks, stamp, skew;
+    unsigned short base, since;
+
+    do				// Retry, if the ISR updated the tick count meanwhile
+    {   ticks = tickerTicks;
+        base = tickerBase;
+        skew = tickerSkew;
+        since = TCNT - base;
+    } while (ticks != tickerTicks);
+
+    stamp = ticks * TENMS + skew + (unsigned short) (tcnt - base);
+    if ((unsigned short) (tcnt - base) > since)	// Captured before the last compare event
+        stamp = stamp - 0x10000UL;
+    return stamp;
+}
+
+// Public interface function: tickerAlign ... Shift the ticks, so that a tick starts at a time stamp
+// Parameter:   stamp   Time stamp in the past, less than 2 hours ago, see tickerTimestamp()
+// Returns:     Tick, which starts at stamp, i.e. tickerNow() counts the ticks since stamp
+//              from the second compare event on. The next one is not shifted yet.
+// Call with interrupts disabled, task context.
+unsigned long tickerAlign(unsigned long stamp)
+{   long diff;
+    int shift;
+
+    diff = (long) (stamp - (tickerTicks * TENMS + tickerSkew + tickerShifted));
+    shift = (int) (diff % TENMS);
+    if (shift > TENMS / 2)
+        shift = shift - TENMS;
+    else if (shift < -TENMS / 2)
+        shift = shift + TENMS;
+    tickerShift = shift;
+    return tickerTicks + (diff - shift) / TENMS;
+}
+
+// Public interface function: tickerTime ... Time stamp of now
+// Returns:     Timer counts (5.33us) since initTicker(), see tickerTimestamp()
+// Can be called in task and ISR context.
+unsigned long tickerTime(void)
+{   return tickerTimestamp(TCNT);
+}
+
+#ifdef CLOCKDISCIPLINE
+// Public interface function: tickerTrim ... Set the correction of the ticker period
+// Parameter:   trim    1/65536 timer counts per tick, i.e. 1 is 0.008ppm, the
+//                      caller limits it to less than one count per tick
+// Takes effect with the next interrupt, can be called in task context.
+void tickerTrim(long trim)
+{   DisableInterrupts;
+    tickerTrimming = trim;
+    EnableInterrupts;
+}
+#endif
+
+#ifdef TICKLESS
+// Public interface function: tickerRequest ... Call tick10ms() again after the given number of ticks
+// Parameter:   client  TICKERCLOCK, TICKERDCF77, ...
+//              ticks   Number of ticks after the current tick, > 0
+void tickerRequest(unsigned char client, unsigned int ticks)
+{   tickerDeadline[client] = tickerTicks + ticks;
+}
+
+// Internal function: isrECT4 ... Interrupt service routine, called at the next deadline
+void HAL_ISR(12) isrECT4(void)
+{   unsigned long next;
+    unsigned char i, due = 0;
+
+    osProfileStart(OSPROFILETICKER);
+    tickerTicks = tickerTicks + tickerPeriod;
+    tickerSkew = tickerSkew + tickerShifted;
+    tickerBase = TC4;
+    tickerShifted = tickerShift;
+    tickerShift = 0;
+    tickerShed = tickerShed > tickerPeriod ? tickerShed - tickerPeriod : 0;
+    tickerCatchUp();		// Late, e.g. after an overrun of the last call
+
+    TFLG1 = TIMER_CH4;		// Clear the interrupt flag, write a 1 to bit 4 only
+
+    for (i = 0; i < TICKERNUMCLIENTS; i++)
+    {   if ((long) (tickerDeadline[i] - tickerTicks) <= 0)
+            due = 1;
+    }
+    if (due)
+    {   tick10ms();		// External function called at the deadline
+        halTick();		// Host build only: spend its virtual run time
+    }
+    tickerCatchUp();		// tick10ms() overran the next compare event
+
+    next = tickerTicks + MAXTICKS;	// Program the earliest deadline
+    for (i = 0; i < TICKERNUMCLIENTS; i++)
+    {   if ((long) (tickerDeadline[i] - next) < 0)
+            next = tickerDeadline[i];
+    }
+    if ((long) (next - tickerTicks) <= 0)
+        next = tickerTicks + 1;
+
+    tickerPeriod = (unsigned char) (next - tickerTicks);
+    TC4 = tickerBase + (unsigned short) tickerPeriod * TENMS + tickerCorrection(tickerPeriod) + tickerShifted;	// MAXTICKS*TENMS + TENMS/2 < 65536, unsigned
+    tickerBudget();
+    osProfileEnd(OSPROFILETICKER);
+}
+#else
 // Internal function: isrECT4 ... Interrupt service routine, called by the timer ticker every 10ms
-void interrupt 12 isrECT4(void)
-{   TC4 = TC4 + TENMS;      	// Schedule the next ISR period
+void HAL_ISR(12) isrECT4(void)
+{   osProfileStart(OSPROFILETICKER);
+    tickerTicks = tickerTicks + 1;
+    tickerSkew = tickerSkew + tickerShifted;
+    tickerBase = TC4;
+    tickerShifted = tickerShift;
+    tickerShift = 0;
+    if (tickerShed > 0)
+        tickerShed--;
+    tickerCatchUp();		// Late, e.g. after an overrun of the last call
+    TC4 = tickerBase + TENMS + tickerCorrection(1) + tickerShifted;	// Schedule the next ISR period
 	
-    TFLG1 = TFLG1 | TIMER_CH4;	// Clear the interrupt flag, write a 1 to bit 4
+    TFLG1 = TIMER_CH4;		// Clear the interrupt flag, write a 1 to bit 4 only
 	
     tick10ms();           	// External function called every 10ms
+    halTick();			// Host build only: spend its virtual run time
+    tickerBudget();
+    osProfileEnd(OSPROFILETICKER);
 }
+#endif
 
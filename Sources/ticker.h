@@ -7,5 +7,38 @@
     Author:   W.Zimmermann, Sept 08, 2020
 */
 
-// Public functions, for details see ticker.asm
+// Convert milliseconds or microseconds into timer counts and back, see tickerTime()
+#define TICKERMS(ms)        ((unsigned long) (ms) * 375 / 2)
+#define TICKERUS(us)        ((unsigned long) (us) * 3 / 16)
+#define TICKERTOUS(counts)  ((unsigned long) (counts) * 16 / 3)
+
+#ifdef TICKLESS
+// Clients of the tickless ticker, see tickerRequest()
+#define TICKERCLOCK         0
+#ifndef DCF77CAPTURE
+#define TICKERDCF77         1                   // Only when sampling the DCF77 signal
+#define TICKERNUMCLIENTS    2
+#else
+#define TICKERNUMCLIENTS    1
+#endif
+#endif
+
+// Overrun statistics and load shedding, for details see ticker.c
+extern unsigned long tickerOverruns;            // Late ISR calls, which missed compare events
+extern unsigned long tickerMissed;              // Ticks caught up by these ISR calls
+extern volatile unsigned char tickerShed;       // > 0: skip optional work, e.g. LEDs
+
+// Public functions, for details see ticker.c
 void initTicker(void);
+void delayTicker(unsigned short counts);
+unsigned long tickerNow(void);
+unsigned long tickerTimestamp(unsigned short tcnt);
+unsigned long tickerTime(void);
+unsigned long tickerAlign(unsigned long stamp);
+#ifdef TICKLESS
+void tickerRequest(unsigned char client, unsigned int ticks);
+#endif
+#ifdef CLOCKDISCIPLINE
+void tickerTrim(long trim);
+#endif
+